@@ -0,0 +1,292 @@
+
+#include <algorithm>
+#include <charconv>
+#include <csignal>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <print> // C++23
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <uvw.hpp>
+
+#include "buffer-pool.hh"
+#include "connection.hh"
+#include "framing.hh"
+#include "protocol.hh"
+#include "reactor.hh"
+
+#include "quantile-sketch.hh"
+#include "running-stats.hh"
+
+// stats-server [port] [threads]
+//
+// takes framed samples over TCP and keeps streaming statistics for each
+// named stream: an ss::running_stats for count, sum and mean, and an
+// ss::quantile_sketch for the median and other quantiles. queries are
+// answered from them (see protocol.hh). port defaults to 4343, threads
+// to one loop per hardware thread; ctrl-c stops it
+//
+// every loop owns the streams of the connections it accepted and is the
+// only thread to touch them, so aggregation takes no lock. a query is
+// answered by the loop that received it: it asks every other loop for a
+// copy of that stream's state through their mailboxes, merges the copies
+// into its own (both accumulators are mergeable) and replies once all
+// have answered. replies go through the connection's write batching
+
+using namespace std;
+
+namespace {
+    struct stream {
+        ss::running_stats stats;
+        ss::quantile_sketch sketch;
+    };
+
+    // lookups by string_view without building a string per frame
+    struct name_hash {
+        using is_transparent = void;
+        size_t operator()(string_view s) const { return hash<string_view>{}(s); }
+    };
+
+    using stream_map = unordered_map<string, stream, name_hash, equal_to<>>;
+
+    // one loop's share of the server
+    struct shard {
+        stream_map streams;
+        vector<int> scratch; // samples copied out of the frame, aligned
+        uint64_t samples = 0;
+        uint64_t queries = 0;
+        unique_ptr<buffer_pool> pool;
+        unique_ptr<write_batcher> batcher;
+
+        // tasks posted by other loops, run on this one
+        shared_ptr<uvw::async_handle> mailbox;
+        mutex lock;
+        vector<function<void()>> inbox;
+        bool closed = false;
+
+        // from any thread; dropped once the server is stopping
+        void post(function<void()> task) {
+            lock_guard guard(lock);
+            if (closed) return;
+            inbox.push_back(std::move(task));
+            mailbox->send();
+        }
+
+        void close() {
+            lock_guard guard(lock);
+            closed = true;
+        }
+
+        void run_inbox() {
+            vector<function<void()>> tasks;
+            {
+                lock_guard guard(lock);
+                tasks.swap(inbox);
+            }
+            for (auto &task : tasks) task();
+        }
+    };
+
+    // a query being answered by the loop it arrived on; only that loop
+    // touches it, the others just hand it copies
+    struct pending_query {
+        protocol::query query;
+        string name; // query.name points into a frame long gone
+        shared_ptr<uvw::tcp_handle> client;
+        size_t remaining = 0;
+        bool found = false;
+        stream merged;
+    };
+
+    class server {
+    public:
+        explicit server(size_t threads) : shards_(threads) {
+            for (auto &s : shards_) s = make_unique<shard>();
+        }
+
+        // the loop is not running yet; per-loop state goes on it here
+        void setup(uvw::loop &loop, size_t worker) {
+            auto &s = *shards_[worker];
+            s.pool = make_unique<buffer_pool>();
+            s.batcher = make_unique<write_batcher>(loop);
+            s.mailbox = loop.resource<uvw::async_handle>();
+            s.mailbox->on<uvw::async_event>([&s](const uvw::async_event &, uvw::async_handle &) { s.run_inbox(); });
+        }
+
+        void accept(uvw::tcp_handle &client, size_t worker) {
+            auto &s = *shards_[worker];
+            client.no_delay(true);
+            auto &conn = connection::attach(client, *s.pool, *s.batcher);
+            auto reader = make_shared<frame_reader>([this, &conn, worker](span<const char> message) {
+                if (!handle(conn, worker, message)) conn.close();
+            });
+            conn.on_data([reader](connection &c, pooled_buffer buffer, size_t length) {
+                if (!reader->feed({buffer.data(), length})) c.close();
+            });
+            conn.read();
+        }
+
+        // no more cross-loop tasks from here on
+        void close_mailboxes() {
+            for (auto &s : shards_) s->close();
+        }
+
+        const vector<unique_ptr<shard>> &shards() const { return shards_; }
+
+    private:
+        // false closes the connection
+        bool handle(connection &conn, size_t worker, span<const char> message) {
+            auto type = protocol::type_of(message);
+            if (type == protocol::type::samples) {
+                auto samples = protocol::parse_samples(message);
+                if (!samples) return false;
+                ingest(*shards_[worker], *samples);
+                return true;
+            }
+            if (type == protocol::type::query) {
+                auto q = protocol::parse_query(message);
+                if (!q) return false;
+                query(conn, worker, std::move(*q));
+                return true;
+            }
+            return false;
+        }
+
+        static void ingest(shard &s, const protocol::samples &samples) {
+            auto it = s.streams.find(samples.name);
+            if (it == s.streams.end()) it = s.streams.try_emplace(string(samples.name)).first;
+
+            s.scratch.resize(samples.count());
+            samples.copy_to(s.scratch.data());
+            it->second.stats.push(s.scratch);
+            it->second.sketch.add(s.scratch);
+            s.samples += s.scratch.size();
+        }
+
+        void query(connection &conn, size_t worker, protocol::query q) {
+            auto &home = *shards_[worker];
+            ++home.queries;
+            auto pending = make_shared<pending_query>();
+            pending->name = string(q.name);
+            pending->query = std::move(q);
+            pending->query.name = pending->name;
+            pending->client = conn.handle().shared_from_this();
+            pending->remaining = shards_.size() - 1;
+            merge(*pending, home);
+
+            if (pending->remaining == 0) {
+                reply(*pending);
+                return;
+            }
+            for (size_t other = 0; other < shards_.size(); ++other) {
+                if (other == worker) continue;
+                shards_[other]->post([this, other, worker, pending]() mutable {
+                    // on the other loop: copy its stream, send it home.
+                    // pending goes home with it, so only the home loop
+                    // ever frees the client handle and merged stream
+                    auto &s = *shards_[other];
+                    auto it = s.streams.find(pending->name);
+                    auto copy = it == s.streams.end() ? nullptr : make_shared<stream>(it->second);
+                    shards_[worker]->post([this, pending = std::move(pending), copy = std::move(copy)] {
+                        if (copy) merge(*pending, *copy);
+                        if (--pending->remaining == 0) reply(*pending);
+                    });
+                });
+            }
+        }
+
+        static void merge(pending_query &p, const shard &s) {
+            auto it = s.streams.find(p.name);
+            if (it != s.streams.end()) merge(p, it->second);
+        }
+
+        static void merge(pending_query &p, const stream &s) {
+            p.found = true;
+            p.merged.stats.merge(s.stats);
+            p.merged.sketch.merge(s.sketch);
+        }
+
+        static void reply(pending_query &p) {
+            auto conn = p.client->data<connection>();
+            if (!conn) return; // closed while the other loops answered
+
+            protocol::reply r;
+            r.id = p.query.id;
+            r.count = p.merged.stats.count();
+            r.sum = p.merged.stats.sum();
+            if (!p.found) {
+                r.status = protocol::status::unknown_stream;
+            } else {
+                switch (p.query.what) {
+                case protocol::what::sum:
+                    break;
+                case protocol::what::mean:
+                    r.values.push_back(p.merged.stats.snapshot().mean);
+                    break;
+                case protocol::what::median:
+                    r.values.push_back(p.merged.sketch.quantile(0.5));
+                    break;
+                case protocol::what::quantiles:
+                    for (auto rank : p.query.ranks) r.values.push_back(p.merged.sketch.quantile(rank));
+                    break;
+                }
+            }
+            auto frame = protocol::encode_reply(conn->pool(), r);
+            conn->write(std::move(frame.buffer), frame.length);
+        }
+
+        vector<unique_ptr<shard>> shards_;
+    };
+
+    // a whole non-negative number, or false
+    bool parse_count(string_view arg, size_t &out) {
+        auto [end, err] = from_chars(arg.data(), arg.data() + arg.size(), out);
+        return err == errc() && end == arg.data() + arg.size();
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    size_t port = 4343;
+    size_t threads = 0;
+    if ((argc > 1 && (!parse_count(argv[1], port) || port > 65535)) || (argc > 2 && !parse_count(argv[2], threads))) {
+        println(stderr, "usage: {} [port] [threads]", argv[0]);
+        return 2;
+    }
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+
+    server srv(threads);
+    reactor_pool pool(
+        {.port = static_cast<unsigned int>(port), .threads = threads},
+        [&srv](uvw::tcp_handle &client, size_t worker) { srv.accept(client, worker); },
+        [&srv](uvw::loop &loop, size_t worker) { srv.setup(loop, worker); });
+    if (!pool.start()) return 1;
+    println("stats-server on 127.0.0.1:{} with {} loops", pool.port(), pool.threads());
+
+    // the main thread only waits for a signal, as in using-uvw's serve
+    auto loop = uvw::loop::get_default();
+    for (auto signum : {SIGINT, SIGTERM}) {
+        auto signal = loop->resource<uvw::signal_handle>();
+        signal->on<uvw::signal_event>([&](const uvw::signal_event &, uvw::signal_handle &handle) {
+            srv.close_mailboxes();
+            pool.stop();
+            handle.parent().walk([](auto &h) { h.close(); });
+        });
+        signal->start(signum);
+    }
+    loop->run();
+    pool.join();
+
+    auto &shards = srv.shards();
+    for (size_t i = 0; i < shards.size(); ++i) {
+        auto &s = *shards[i];
+        println("loop {}: {} streams, {} samples, {} queries", i, s.streams.size(), s.samples, s.queries);
+    }
+    return 0;
+}
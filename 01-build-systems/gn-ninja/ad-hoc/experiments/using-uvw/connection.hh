@@ -0,0 +1,625 @@
+#ifndef USING_UVW_CONNECTION_H
+#define USING_UVW_CONNECTION_H
+
+// a tcp_handle whose reads land in, and whose writes leave from, buffers
+// of its loop's buffer_pool, so a message costs no heap allocation in
+// either direction once the pool is warm
+//
+// uvw allocates a fresh buffer for every read, so reading goes through
+// libuv directly with the pool as its allocator. writes hand the pooled
+// buffer itself to libuv, and it goes back to the pool when libuv reports
+// the write done (or at once, when the socket takes it all straight away)
+//
+// small writes are not sent one by one: they queue on the connection and
+// go out together as one vectored write, when the queue reaches a limit
+// or, at the latest, once the loop has run this iteration's callbacks
+// (see write_options). a large write flushes the queue along with itself
+//
+// what is written but not yet taken by the kernel is bounded: a
+// connection over its high watermark stops reading until it drains to
+// its low one, and while its loop holds more than loop_limit in total,
+// any connection that reads stops too, until the loop is down to half
+//
+// a connection_registry keeps the live connections of one loop on an
+// intrusive list, so adding and removing one is O(1) however many there
+// are, and counts them in atomics that any thread may read
+//
+// a connection given timeout_options closes itself once it has been idle,
+// or waited on a read or on the kernel taking its writes, for too long.
+// the deadlines live on its loop's loop_timers, one timer_wheel behind a
+// single timer_handle, so re-arming one on every read costs a list unlink
+// and link rather than a libuv timer per connection
+#include <uvw.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "buffer-pool.hh"
+#include "timer-wheel.hh"
+
+struct write_options {
+    std::size_t max_bytes = 64 << 10;   // flush once this much is queued
+    std::size_t max_buffers = 16;       // or this many writes (1: no batching)
+    std::size_t pass_through = 8 << 10; // writes this large flush at once
+    bool end_of_tick = true;            // flush leftovers after each loop iteration
+
+    std::size_t high_watermark = 1 << 20;  // stop reading above this many bytes unsent
+    std::size_t low_watermark = 256 << 10; // and read again at this many
+    std::size_t loop_limit = 64 << 20;     // unsent bytes over all of a loop's connections
+};
+
+// how long a connection may wait before it is closed; zero never closes
+struct timeout_options {
+    std::chrono::milliseconds idle{0};  // with nothing read or written
+    std::chrono::milliseconds read{0};  // reading, with nothing arriving (not while paused)
+    std::chrono::milliseconds write{0}; // with bytes unsent and none leaving
+};
+
+class connection;
+
+// one loop's live connections; counts() from any thread, the rest only
+// on the loop's own
+class connection_registry {
+public:
+    struct counts {
+        std::uint64_t live = 0;
+        std::uint64_t accepted = 0; // ever tracked
+        std::uint64_t closed = 0;
+        std::uint64_t errored = 0;  // of the closed, those closed by an error
+        std::uint64_t timed_out = 0; // and those closed by a timeout
+    };
+
+    connection_registry() = default;
+    connection_registry(const connection_registry &) = delete;
+    connection_registry &operator=(const connection_registry &) = delete;
+
+    counts read() const {
+        return {live_.load(std::memory_order_relaxed), accepted_.load(std::memory_order_relaxed),
+                closed_.load(std::memory_order_relaxed), errored_.load(std::memory_order_relaxed),
+                timed_out_.load(std::memory_order_relaxed)};
+    }
+
+    std::uint64_t live() const { return live_.load(std::memory_order_relaxed); }
+
+    // f(connection &) for every live connection, newest first
+    template <typename F> void for_each(F &&f) const;
+
+private:
+    friend class connection;
+
+    inline void add(connection &conn);
+    inline void remove(connection &conn);
+
+    // only the loop's thread writes these
+    static void bump(std::atomic<std::uint64_t> &c, std::int64_t by) {
+        c.store(c.load(std::memory_order_relaxed) + static_cast<std::uint64_t>(by), std::memory_order_relaxed);
+    }
+
+    connection *head_ = nullptr;
+    std::atomic<std::uint64_t> live_{0};
+    std::atomic<std::uint64_t> accepted_{0};
+    std::atomic<std::uint64_t> closed_{0};
+    std::atomic<std::uint64_t> errored_{0};
+    std::atomic<std::uint64_t> timed_out_{0};
+};
+
+// the end-of-tick flush for every connection on one loop, through a
+// check handle, which libuv runs right after the iteration's I/O callbacks;
+// also the loop's count of unsent bytes and its paused connections
+class write_batcher {
+public:
+    struct counters {
+        std::uint64_t messages = 0;      // write() calls
+        std::uint64_t writes = 0;        // uv_write calls, and uv_try_write calls that reached the socket
+        std::uint64_t bytes = 0;
+        std::uint64_t pauses = 0;        // reads stopped for backpressure
+        std::uint64_t paused_ns = 0;     // summed over connections, for finished pauses
+        std::uint64_t buffered = 0;      // unsent bytes right now
+        std::uint64_t peak_buffered = 0;
+    };
+
+    explicit write_batcher(uvw::loop &loop, write_options options = {})
+        : options_(options), check_(loop.resource<uvw::check_handle>()) {
+        check_->on<uvw::check_event>([this](const uvw::check_event &, uvw::check_handle &) { flush_all(); });
+    }
+
+    write_batcher(const write_batcher &) = delete;
+    write_batcher &operator=(const write_batcher &) = delete;
+
+    const write_options &options() const { return options_; }
+    const counters &stats() const { return stats_; }
+
+private:
+    friend class connection;
+
+    inline void schedule(connection *conn);
+    inline void forget(connection *conn);
+
+    inline void flush_all();
+
+    void grew(std::size_t n) {
+        stats_.buffered += n;
+        stats_.peak_buffered = std::max(stats_.peak_buffered, stats_.buffered);
+    }
+
+    // true when this took the loop back to half its limit, so that the
+    // connections it paused may read again
+    bool shrank(std::size_t n) {
+        auto before = stats_.buffered;
+        stats_.buffered -= n;
+        return before > options_.loop_limit / 2 && under_limit();
+    }
+
+    bool over_limit() const { return stats_.buffered > options_.loop_limit; }
+    bool under_limit() const { return stats_.buffered <= options_.loop_limit / 2; }
+
+    inline void resume_ready();
+
+    write_options options_;
+    std::shared_ptr<uvw::check_handle> check_;
+    std::vector<connection *> dirty_;
+    std::vector<connection *> flushing_;
+    std::vector<connection *> paused_;
+    counters stats_;
+};
+
+// one loop's timer_wheel, ticking in milliseconds of loop time. its one
+// timer_handle is started for the wheel's next event only, and does not
+// keep the loop running by itself
+class loop_timers {
+public:
+    explicit loop_timers(uvw::loop &loop)
+        : loop_(loop), wheel_(ticks()), handle_(loop.resource<uvw::timer_handle>()) {
+        handle_->on<uvw::timer_event>([this](const uvw::timer_event &, uvw::timer_handle &) {
+            scheduled_.reset();
+            wheel_.advance(ticks());
+            schedule();
+        });
+        handle_->unreference();
+    }
+
+    loop_timers(const loop_timers &) = delete;
+    loop_timers &operator=(const loop_timers &) = delete;
+
+    // (re)arms timer to fire after this long
+    void arm(wheel_timer &timer, std::chrono::milliseconds after) {
+        wheel_.arm(timer, ticks() + static_cast<std::uint64_t>(after.count()));
+        schedule();
+    }
+
+    // leaves the handle as it is; waking early for nothing is cheaper
+    // than restarting it on every cancel
+    void cancel(wheel_timer &timer) { wheel_.cancel(timer); }
+
+    std::size_t size() const { return wheel_.size(); }
+
+private:
+    std::uint64_t ticks() const { return loop_.now().count(); }
+
+    void schedule() {
+        auto next = wheel_.next_event();
+        if (!next) {
+            handle_->stop();
+            scheduled_.reset();
+            return;
+        }
+        if (scheduled_ && *scheduled_ <= *next) return;
+        scheduled_ = next;
+        auto now = ticks();
+        handle_->start(uvw::timer_handle::time{*next > now ? *next - now : 0}, uvw::timer_handle::time{0});
+    }
+
+    uvw::loop &loop_;
+    timer_wheel wheel_;
+    std::shared_ptr<uvw::timer_handle> handle_;
+    std::optional<std::uint64_t> scheduled_; // the tick the handle is started for
+};
+
+class connection {
+public:
+    // a read of length bytes, at the start of buffer; keep the buffer to
+    // keep the bytes, or pass it on to write() to send them back
+    using data_fn = std::function<void(connection &, pooled_buffer buffer, std::size_t length)>;
+    using close_fn = std::function<void(connection &)>;
+
+    // takes over client's reads and writes. the connection is the
+    // handle's user data, and lives until the handle is closed
+    static connection &attach(uvw::tcp_handle &client, buffer_pool &pool, write_batcher &batcher,
+                              std::size_t read_size = 16 << 10) {
+        auto conn = std::shared_ptr<connection>(new connection(client, pool, batcher, read_size));
+        client.data(conn);
+        client.on<uvw::error_event>([](const uvw::error_event &, uvw::tcp_handle &handle) {
+            if (auto self = handle.data<connection>()) self->fail();
+        });
+        client.on<uvw::shutdown_event>([](const uvw::shutdown_event &, uvw::tcp_handle &handle) { handle.close(); });
+        client.on<uvw::close_event>([](const uvw::close_event &, uvw::tcp_handle &handle) {
+            // libuv has cancelled any writes still in flight by now, and
+            // what never left the queue goes back to the pool here
+            auto self = handle.data<connection>();
+            self->batcher_.forget(self.get());
+            self->unpause();
+            self->release(self->queued_bytes_);
+            self->drop_queue();
+            self->stop_timers();
+            if (self->registry_) self->registry_->remove(*self);
+            if (self->on_close_) self->on_close_(*self);
+            handle.data(nullptr);
+        });
+        return *conn;
+    }
+
+    // counts the connection in registry, until it closes
+    void track(connection_registry &registry) {
+        if (registry_) return;
+        registry_ = &registry;
+        registry.add(*this);
+    }
+
+    // closes the connection when one of options' timeouts passes, through
+    // the usual close_event; the registry counts it as timed out
+    void expire_after(loop_timers &timers, timeout_options options) {
+        stop_timers();
+        timers_ = &timers;
+        timeouts_ = options;
+        for (auto *timer : {&idle_timer_, &read_timer_, &write_timer_}) timer->on_fire([this] { expire(); });
+        restart(idle_timer_, timeouts_.idle);
+        if (reading_ && !paused_) restart(read_timer_, timeouts_.read);
+        if (buffered_ > 0) restart(write_timer_, timeouts_.write);
+    }
+
+    void on_data(data_fn f) { on_data_ = std::move(f); }
+    void on_close(close_fn f) { on_close_ = std::move(f); }
+
+    // starts delivering reads to on_data; end of stream and errors close
+    // the connection
+    int read() {
+        reading_ = true;
+        if (paused_) return 0;
+        restart(read_timer_, timeouts_.read);
+        return uv_read_start(stream(), allocate, received);
+    }
+
+    // zero copy: the first length bytes of buffer go out as they are
+    void write(pooled_buffer buffer, std::size_t length) {
+        if (handle_.closing()) return;
+        auto &options = batcher_.options();
+        ++batcher_.stats_.messages;
+        queued_bufs_.push_back(uv_buf_init(buffer.data(), static_cast<unsigned int>(length)));
+        queued_.push_back(std::move(buffer));
+        queued_bytes_ += length;
+        buffered_ += length;
+        batcher_.grew(length);
+        restart(idle_timer_, timeouts_.idle);
+        if (buffered_ == length) restart(write_timer_, timeouts_.write);
+
+        if (length >= options.pass_through || queued_bytes_ >= options.max_bytes ||
+            queued_.size() >= options.max_buffers) {
+            flush();
+        } else if (options.end_of_tick && !scheduled_) {
+            scheduled_ = true;
+            batcher_.schedule(this);
+        }
+        check_pressure();
+    }
+
+    // copies bytes into a pooled buffer and writes that
+    void write(std::string_view bytes) {
+        auto buffer = pool_.acquire(bytes.size());
+        std::copy(bytes.begin(), bytes.end(), buffer.data());
+        write(std::move(buffer), bytes.size());
+    }
+
+    // sends whatever is queued, as one vectored write
+    void flush() {
+        if (queued_.empty() || handle_.closing()) return;
+        batcher_.stats_.bytes += queued_bytes_;
+
+        // straight to the socket when nothing is queued in libuv ahead,
+        // which needs no request at all; libuv refuses (EAGAIN) otherwise
+        auto n = uv_try_write(stream(), queued_bufs_.data(), static_cast<unsigned int>(queued_bufs_.size()));
+        if (n != UV_EAGAIN) ++batcher_.stats_.writes; // a refusal made no syscall
+        if (n < 0 && n != UV_EAGAIN) {
+            fail();
+            return;
+        }
+        auto sent = static_cast<std::size_t>(n > 0 ? n : 0);
+        release(sent);
+        if (sent == queued_bytes_) {
+            drop_queue();
+            return;
+        }
+
+        // skip what the socket took; the partly sent buffer starts later
+        auto unsent = queued_bytes_ - sent;
+        std::size_t first = 0;
+        while (sent >= queued_bufs_[first].len) sent -= queued_bufs_[first++].len;
+        queued_bufs_[first].base += sent;
+        queued_bufs_[first].len -= sent;
+
+        // the request takes the buffers and leaves its spare (empty)
+        // vector for the next batch to queue into
+        auto *request = take_request();
+        std::swap(request->buffers, queued_);
+        request->bytes = unsent;
+        ++batcher_.stats_.writes;
+        auto err = uv_write(&request->req, stream(), queued_bufs_.data() + first,
+                            static_cast<unsigned int>(queued_bufs_.size() - first), written);
+        queued_bufs_.clear();
+        queued_bytes_ = 0;
+        if (err != 0) {
+            request->buffers.clear();
+            spare_.push_back(request);
+            release(unsent);
+            fail();
+        }
+    }
+
+    // flushes, then closes once everything written has left
+    void shutdown() {
+        flush();
+        if (!handle_.closing() && handle_.shutdown() != 0) close();
+    }
+
+    void close() {
+        if (!handle_.closing()) handle_.close();
+    }
+
+    // closes, counted as an error
+    void fail() {
+        errored_ = errored_ || !handle_.closing();
+        close();
+    }
+
+    uvw::tcp_handle &handle() { return handle_; }
+    buffer_pool &pool() { return pool_; }
+
+    // bytes written but not yet taken by the kernel, queued here or in libuv
+    std::size_t buffered() const { return buffered_; }
+    bool paused() const { return paused_; }
+
+private:
+    friend class write_batcher;
+    friend class connection_registry;
+
+    struct write_request {
+        uv_write_t req; // first, so the request's address is the struct's
+        std::vector<pooled_buffer> buffers;
+        std::size_t bytes;
+        connection *owner;
+    };
+
+    connection(uvw::tcp_handle &handle, buffer_pool &pool, write_batcher &batcher, std::size_t read_size)
+        : handle_(handle), pool_(pool), batcher_(batcher), read_size_(read_size) {}
+
+    uv_stream_t *stream() { return reinterpret_cast<uv_stream_t *>(handle_.raw()); }
+
+    // uvw keeps its handle object in the libuv handle's data field, and
+    // the connection in the handle's user data
+    static connection &from(void *raw) {
+        auto *handle = static_cast<uvw::tcp_handle *>(static_cast<uv_handle_t *>(raw)->data);
+        return *handle->data<connection>();
+    }
+
+    static void allocate(uv_handle_t *raw, std::size_t, uv_buf_t *buf) {
+        auto &self = from(raw);
+        self.incoming_ = self.pool_.acquire(self.read_size_);
+        *buf = uv_buf_init(self.incoming_.data(), static_cast<unsigned int>(self.incoming_.capacity()));
+    }
+
+    static void received(uv_stream_t *raw, ssize_t nread, const uv_buf_t *) {
+        auto &self = from(raw);
+        auto buffer = std::move(self.incoming_);
+        if (nread > 0) {
+            self.restart(self.idle_timer_, self.timeouts_.idle);
+            self.restart(self.read_timer_, self.timeouts_.read);
+            if (self.on_data_) self.on_data_(self, std::move(buffer), static_cast<std::size_t>(nread));
+            self.check_pressure();
+        } else if (nread == UV_EOF) {
+            self.close();
+        } else if (nread < 0) {
+            self.fail(); // 0 is just "nothing yet"
+        }
+    }
+
+    static void written(uv_write_t *req, int status) {
+        auto *request = reinterpret_cast<write_request *>(req);
+        auto &self = *request->owner;
+        request->buffers.clear();
+        self.spare_.push_back(request);
+        self.release(request->bytes);
+        if (status < 0 && status != UV_ECANCELED) self.fail();
+    }
+
+    // requests are recycled per connection, like the buffers they carry
+    write_request *take_request() {
+        if (spare_.empty()) {
+            requests_.push_back(std::make_unique<write_request>());
+            requests_.back()->owner = this;
+            return requests_.back().get();
+        }
+        auto *request = spare_.back();
+        spare_.pop_back();
+        return request;
+    }
+
+    // stops reading when this connection or its loop holds too much
+    void check_pressure() {
+        auto &options = batcher_.options();
+        if (paused_ || handle_.closing()) return;
+        if (buffered_ <= options.high_watermark && !batcher_.over_limit()) return;
+        paused_ = true;
+        paused_at_ = std::chrono::steady_clock::now();
+        ++batcher_.stats_.pauses;
+        paused_index_ = batcher_.paused_.size();
+        batcher_.paused_.push_back(this);
+        if (reading_) uv_read_stop(stream());
+        stop(read_timer_); // the wait is ours now, not the peer's
+    }
+
+    bool may_resume() const { return buffered_ <= batcher_.options().low_watermark && batcher_.under_limit(); }
+
+    void resume() {
+        unpause();
+        if (reading_ && !handle_.closing()) {
+            restart(read_timer_, timeouts_.read);
+            uv_read_start(stream(), allocate, received);
+        }
+    }
+
+    void unpause() {
+        if (!paused_) return;
+        paused_ = false;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - paused_at_);
+        batcher_.stats_.paused_ns += static_cast<std::uint64_t>(ns.count());
+        // the last paused connection takes this one's place
+        auto &paused = batcher_.paused_;
+        paused[paused_index_] = paused.back();
+        paused[paused_index_]->paused_index_ = paused_index_;
+        paused.pop_back();
+    }
+
+    // n bytes went to the kernel or were dropped
+    void release(std::size_t n) {
+        if (n == 0) return;
+        buffered_ -= n;
+        if (buffered_ == 0) {
+            stop(write_timer_);
+        } else {
+            restart(write_timer_, timeouts_.write); // progress, so wait afresh
+        }
+        if (batcher_.shrank(n)) batcher_.resume_ready();
+        if (paused_ && may_resume()) resume();
+    }
+
+    void restart(wheel_timer &timer, std::chrono::milliseconds after) {
+        if (timers_ && after.count() > 0 && !handle_.closing()) timers_->arm(timer, after);
+    }
+
+    void stop(wheel_timer &timer) {
+        if (timers_) timers_->cancel(timer);
+    }
+
+    void stop_timers() {
+        for (auto *timer : {&idle_timer_, &read_timer_, &write_timer_}) stop(*timer);
+    }
+
+    void expire() {
+        timed_out_ = timed_out_ || !handle_.closing();
+        close();
+    }
+
+    void drop_queue() {
+        queued_.clear();
+        queued_bufs_.clear();
+        queued_bytes_ = 0;
+    }
+
+    uvw::tcp_handle &handle_;
+    buffer_pool &pool_;
+    write_batcher &batcher_;
+    std::size_t read_size_;
+    pooled_buffer incoming_; // between allocate and received
+    data_fn on_data_;
+    close_fn on_close_;
+
+    // the outbound queue, and the buffer list libuv reads it through
+    std::vector<pooled_buffer> queued_;
+    std::vector<uv_buf_t> queued_bufs_;
+    std::size_t queued_bytes_ = 0;
+    bool scheduled_ = false; // on the batcher's list for this iteration
+    std::size_t dirty_index_ = 0; // where on that list, while scheduled_
+
+    std::size_t buffered_ = 0;
+    bool reading_ = false; // read() was called
+    bool paused_ = false;  // reads stopped for backpressure
+    std::size_t paused_index_ = 0; // where on the batcher's paused_, while paused_
+    std::chrono::steady_clock::time_point paused_at_;
+
+    std::vector<std::unique_ptr<write_request>> requests_;
+    std::vector<write_request *> spare_;
+
+    // registry_'s intrusive list
+    connection_registry *registry_ = nullptr;
+    connection *prev_ = nullptr;
+    connection *next_ = nullptr;
+    bool errored_ = false;
+    bool timed_out_ = false;
+
+    // deadlines on timers_, from expire_after()
+    loop_timers *timers_ = nullptr;
+    timeout_options timeouts_;
+    wheel_timer idle_timer_;
+    wheel_timer read_timer_;
+    wheel_timer write_timer_;
+};
+
+inline void connection_registry::add(connection &conn) {
+    conn.next_ = head_;
+    if (head_) head_->prev_ = &conn;
+    head_ = &conn;
+    bump(live_, 1);
+    bump(accepted_, 1);
+}
+
+inline void connection_registry::remove(connection &conn) {
+    if (conn.prev_) {
+        conn.prev_->next_ = conn.next_;
+    } else {
+        head_ = conn.next_;
+    }
+    if (conn.next_) conn.next_->prev_ = conn.prev_;
+    conn.prev_ = conn.next_ = nullptr;
+    bump(live_, -1);
+    bump(closed_, 1);
+    if (conn.errored_) bump(errored_, 1);
+    if (conn.timed_out_) bump(timed_out_, 1);
+}
+
+template <typename F> void connection_registry::for_each(F &&f) const {
+    // f may close connections; closing completes later, so next_ holds
+    for (auto *conn = head_; conn; conn = conn->next_) f(*conn);
+}
+
+inline void write_batcher::schedule(connection *conn) {
+    if (dirty_.empty()) check_->start();
+    conn->dirty_index_ = dirty_.size();
+    dirty_.push_back(conn);
+}
+
+// a closed connection's entry is nulled rather than erased, so a storm
+// of closes does not walk the list once each
+inline void write_batcher::forget(connection *conn) {
+    if (conn->scheduled_) dirty_[conn->dirty_index_] = nullptr;
+}
+
+inline void write_batcher::flush_all() {
+    // a flush may close a connection, but closing completes in a later
+    // phase, so every pointer taken here stays good through the loop
+    std::swap(dirty_, flushing_);
+    for (auto *conn : flushing_) {
+        if (!conn) continue;
+        conn->scheduled_ = false;
+        conn->flush();
+    }
+    flushing_.clear();
+    if (dirty_.empty()) check_->stop();
+}
+
+inline void write_batcher::resume_ready() {
+    // resume() moves the last connection, already looked at, into the
+    // place of the one it takes off paused_
+    for (std::size_t i = paused_.size(); i-- > 0;) {
+        if (paused_[i]->may_resume()) paused_[i]->resume();
+    }
+}
+
+#endif /* USING_UVW_CONNECTION_H */
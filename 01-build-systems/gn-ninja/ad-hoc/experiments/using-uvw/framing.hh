@@ -0,0 +1,163 @@
+#ifndef USING_UVW_FRAMING_H
+#define USING_UVW_FRAMING_H
+
+// length-prefixed messages on a byte stream: each message is its length
+// as an unsigned LEB128 varint (1 to 5 bytes, 7 bits per byte, low bits
+// first), then that many bytes
+//
+// frame_reader parses messages where they lie in the receive buffer and
+// hands them out as spans, valid for the duration of the callback. only a
+// message that straddles reads is copied, into a reassembly buffer that
+// holds just that one message, and is freed after a large one
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "buffer-pool.hh"
+
+namespace framing {
+    constexpr std::size_t max_header = 5;
+
+    // writes length's header to out, returning its size
+    inline std::size_t put_header(std::uint32_t length, char *out) {
+        std::size_t n = 0;
+        while (length >= 0x80) {
+            out[n++] = static_cast<char>(length | 0x80);
+            length >>= 7;
+        }
+        out[n++] = static_cast<char>(length);
+        return n;
+    }
+
+    enum class header_status { complete, incomplete, malformed };
+
+    struct header {
+        header_status status;
+        std::uint32_t length = 0; // when complete
+        std::size_t size = 0;     // bytes the header took, when complete
+    };
+
+    inline header get_header(std::span<const char> bytes) {
+        std::uint32_t length = 0;
+        for (std::size_t i = 0; i < max_header; ++i) {
+            if (i == bytes.size()) return {header_status::incomplete};
+            auto b = static_cast<std::uint8_t>(bytes[i]);
+            // the fifth byte has room for the top 4 bits only
+            if (i == max_header - 1 && b > 0x0f) return {header_status::malformed};
+            length |= static_cast<std::uint32_t>(b & 0x7f) << (7 * i);
+            if ((b & 0x80) == 0) return {header_status::complete, length, i + 1};
+        }
+        return {header_status::malformed};
+    }
+
+    // a framed message in a pooled buffer, ready for connection::write
+    struct frame {
+        pooled_buffer buffer;
+        std::size_t length;
+    };
+
+    inline frame make_frame(buffer_pool &pool, std::string_view payload) {
+        auto buffer = pool.acquire(max_header + payload.size());
+        auto n = put_header(static_cast<std::uint32_t>(payload.size()), buffer.data());
+        std::copy(payload.begin(), payload.end(), buffer.data() + n);
+        return {std::move(buffer), n + payload.size()};
+    }
+} // namespace framing
+
+class frame_reader {
+public:
+    using message_fn = std::function<void(std::span<const char> message)>;
+
+    // messages longer than max_message are a protocol error
+    explicit frame_reader(message_fn on_message, std::size_t max_message = 16 << 20)
+        : on_message_(std::move(on_message)), max_message_(max_message) {}
+
+    // delivers every message that bytes completes; false once the stream
+    // is malformed or a message is too long, after which the reader stays
+    // failed and the connection should be closed
+    bool feed(std::span<const char> bytes) {
+        if (failed_) return false;
+
+        // finish the message left over from the previous read first
+        while (!partial_.empty() && !bytes.empty()) {
+            auto h = framing::get_header(partial_);
+            if (h.status == framing::header_status::malformed) return fail();
+            if (h.status == framing::header_status::incomplete) {
+                partial_.push_back(bytes.front());
+                bytes = bytes.subspan(1);
+                continue;
+            }
+            if (h.length > max_message_) return fail();
+
+            auto total = h.size + h.length;
+            partial_.reserve(total);
+            auto take = std::min(total - partial_.size(), bytes.size());
+            partial_.insert(partial_.end(), bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(take));
+            bytes = bytes.subspan(take);
+            if (partial_.size() == total) {
+                on_message_(std::span<const char>(partial_).subspan(h.size));
+                reset();
+            }
+        }
+        // a header completed by the last byte of a read: check it now
+        // rather than on the next read
+        if (!partial_.empty()) return check_partial();
+
+        // the rest straight out of the caller's buffer
+        while (!bytes.empty()) {
+            auto h = framing::get_header(bytes);
+            if (h.status == framing::header_status::malformed) return fail();
+            if (h.status == framing::header_status::complete && h.length > max_message_) return fail();
+            if (h.status == framing::header_status::incomplete || bytes.size() - h.size < h.length) {
+                if (h.status == framing::header_status::complete) partial_.reserve(h.size + h.length);
+                partial_.assign(bytes.begin(), bytes.end());
+                break;
+            }
+            on_message_(bytes.subspan(h.size, h.length));
+            bytes = bytes.subspan(h.size + h.length);
+        }
+        return true;
+    }
+
+    // bytes held over for a message not yet complete
+    std::size_t buffered() const { return partial_.size(); }
+    bool failed() const { return failed_; }
+
+private:
+    // most messages fit a read and never come here; one near max_message
+    // should not leave its whole size reserved for the connection's life
+    static constexpr std::size_t kept_capacity = 64 << 10;
+
+    void reset() {
+        if (partial_.capacity() > kept_capacity) {
+            std::vector<char>().swap(partial_);
+        } else {
+            partial_.clear();
+        }
+    }
+
+    bool fail() {
+        failed_ = true;
+        reset();
+        return false;
+    }
+
+    bool check_partial() {
+        auto h = framing::get_header(partial_);
+        if (h.status == framing::header_status::malformed) return fail();
+        if (h.status == framing::header_status::complete && h.length > max_message_) return fail();
+        return true;
+    }
+
+    message_fn on_message_;
+    std::size_t max_message_;
+    std::vector<char> partial_; // reassembly buffer
+    bool failed_ = false;
+};
+
+#endif /* USING_UVW_FRAMING_H */
@@ -0,0 +1,296 @@
+#ifndef USING_UVW_LOGGER_H
+#define USING_UVW_LOGGER_H
+
+// logging off the event loop: a log() call stores a binary record (a
+// timestamp, the format string's address and up to max_args arguments)
+// in a ring owned by the calling thread, and a background thread formats
+// the records and writes them out. each ring has one writer and one
+// reader, so a record costs a clock read, a few stores and one release
+// store, no lock and no syscall. a full ring drops the record and counts
+// it rather than waiting; the drops are reported in the output
+//
+// formats use "{}" for each argument, like std::format without specs,
+// and must be string literals, as only their address is stored.
+// arguments are integers, floating point, bools and strings; strings
+// longer than arg::text_max are cut short
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// a format string known at compile time; anything else does not compile
+struct log_format {
+    const char *text;
+    consteval log_format(const char *s) : text(s) {}
+};
+
+class async_logger {
+public:
+    static constexpr std::size_t max_args = 4;
+    static constexpr std::chrono::milliseconds max_idle{100}; // longest sleep with nothing logged
+
+    explicit async_logger(std::FILE *sink = stdout, std::size_t ring_records = 4096,
+                          std::chrono::milliseconds interval = std::chrono::milliseconds{1})
+        : sink_(sink), capacity_(std::bit_ceil(std::max<std::size_t>(ring_records, 2))), interval_(interval),
+          id_(next_id().fetch_add(1, std::memory_order_relaxed)), start_(std::chrono::steady_clock::now()),
+          writer_([this] { run(); }) {}
+
+    // writes out everything logged before the call
+    ~async_logger() {
+        {
+            std::lock_guard guard(lock_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        writer_.join();
+    }
+
+    async_logger(const async_logger &) = delete;
+    async_logger &operator=(const async_logger &) = delete;
+
+    template <typename... Args>
+        requires(sizeof...(Args) <= max_args)
+    void log(log_format format, const Args &...args) {
+        auto &r = local_ring();
+        auto head = r.head.load(std::memory_order_relaxed);
+        if (head - r.cached_tail == capacity_) {
+            r.cached_tail = r.tail.load(std::memory_order_acquire);
+            if (head - r.cached_tail == capacity_) {
+                r.dropped.store(r.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        auto &rec = r.slots[head & (capacity_ - 1)];
+        rec.time = std::chrono::steady_clock::now();
+        rec.format = format.text;
+        rec.count = sizeof...(Args);
+        [[maybe_unused]] std::size_t i = 0;
+        (store(rec.args[i++], args), ...);
+        r.head.store(head + 1, std::memory_order_release);
+
+        // a backed-off writer might not look before the ring fills, so
+        // half way there it is woken; by the cached tail this is once per
+        // refresh, and by the real one only when still half full
+        if (head + 1 - r.cached_tail == capacity_ / 2) {
+            r.cached_tail = r.tail.load(std::memory_order_acquire);
+            if (head + 1 - r.cached_tail >= capacity_ / 2) {
+                nudged_.store(true, std::memory_order_relaxed);
+                wake_.notify_one();
+            }
+        }
+    }
+
+    // records formatted and written, and records dropped, so far
+    std::uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct arg {
+        static constexpr std::size_t text_max = 22;
+        enum class kind : std::uint8_t { i64, u64, f64, boolean, text } k;
+        std::uint8_t length;
+        union {
+            std::int64_t i;
+            std::uint64_t u;
+            double d;
+            char text[text_max];
+        };
+    };
+
+    struct record {
+        std::chrono::steady_clock::time_point time;
+        const char *format;
+        std::size_t count;
+        std::array<arg, max_args> args;
+    };
+
+    // one thread's records; head is the writer's, tail the reader's
+    struct ring {
+        alignas(64) std::atomic<std::uint64_t> head{0};
+        std::uint64_t cached_tail = 0; // the writer's last look at tail
+        std::atomic<std::uint64_t> dropped{0};
+        alignas(64) std::atomic<std::uint64_t> tail{0};
+        std::uint64_t dropped_seen = 0; // the reader's
+        unsigned thread = 0;
+        std::unique_ptr<record[]> slots;
+    };
+
+    template <typename T> static void store(arg &a, const T &value) {
+        if constexpr (std::same_as<T, bool>) {
+            a.k = arg::kind::boolean;
+            a.u = value;
+        } else if constexpr (std::signed_integral<T>) {
+            a.k = arg::kind::i64;
+            a.i = value;
+        } else if constexpr (std::unsigned_integral<T>) {
+            a.k = arg::kind::u64;
+            a.u = value;
+        } else if constexpr (std::floating_point<T>) {
+            a.k = arg::kind::f64;
+            a.d = value;
+        } else {
+            static_assert(std::is_convertible_v<const T &, std::string_view>, "log arguments are numbers or strings");
+            auto s = std::string_view(value);
+            a.k = arg::kind::text;
+            a.length = static_cast<std::uint8_t>(std::min(s.size(), arg::text_max));
+            std::memcpy(a.text, s.data(), a.length);
+        }
+    }
+
+    static std::atomic<std::uint64_t> &next_id() {
+        static std::atomic<std::uint64_t> id{1};
+        return id;
+    }
+
+    // the calling thread's ring, made on its first log() to this logger.
+    // a thread keeps one entry per logger it has used, found by logger id
+    // (ids are never reused, so a dead logger's entry is never matched),
+    // with the last one used checked first
+    ring &local_ring() {
+        struct owned {
+            std::uint64_t logger;
+            ring *r;
+        };
+        thread_local std::vector<owned> owned_rings;
+        thread_local owned last{0, nullptr};
+        if (last.logger == id_) return *last.r;
+        for (auto &o : owned_rings) {
+            if (o.logger == id_) {
+                last = o;
+                return *o.r;
+            }
+        }
+
+        auto r = std::make_unique<ring>();
+        r->slots = std::make_unique<record[]>(capacity_);
+        std::lock_guard guard(lock_);
+        r->thread = static_cast<unsigned>(rings_.size());
+        last = {id_, r.get()};
+        owned_rings.push_back(last);
+        rings_.push_back(std::move(r));
+        return *last.r;
+    }
+
+    // the background thread: drain every ring, write, sleep, repeat. while
+    // nothing is logged it sleeps twice as long after each empty pass, up
+    // to max_idle, and is back to interval_ once a pass finds records or a
+    // half full ring wakes it (a wakeup missed in between costs one sleep)
+    void run() {
+        std::string out;
+        std::vector<ring *> rings;
+        auto wait = interval_;
+        for (;;) {
+            bool stopping;
+            {
+                std::unique_lock guard(lock_);
+                wake_.wait_for(guard, wait,
+                               [this] { return stopping_ || nudged_.load(std::memory_order_relaxed); });
+                nudged_.store(false, std::memory_order_relaxed);
+                stopping = stopping_;
+                // rings are never removed before the logger goes, so the
+                // pointers stay good outside the lock
+                rings.clear();
+                for (auto &r : rings_) rings.push_back(r.get());
+            }
+            for (auto *r : rings) drain(*r, out);
+            if (!out.empty()) {
+                std::fwrite(out.data(), 1, out.size(), sink_);
+                std::fflush(sink_);
+                out.clear();
+                wait = interval_;
+            } else {
+                wait = std::min(wait * 2, std::max(interval_, max_idle));
+            }
+            if (stopping) return;
+        }
+    }
+
+    void drain(ring &r, std::string &out) {
+        auto tail = r.tail.load(std::memory_order_relaxed);
+        auto head = r.head.load(std::memory_order_acquire);
+        for (auto i = tail; i != head; ++i) format(r, r.slots[i & (capacity_ - 1)], out);
+        r.tail.store(head, std::memory_order_release);
+        written_.fetch_add(head - tail, std::memory_order_relaxed);
+
+        auto dropped = r.dropped.load(std::memory_order_relaxed);
+        if (dropped != r.dropped_seen) {
+            out += "[log] thread " + std::to_string(r.thread) + " dropped " +
+                   std::to_string(dropped - r.dropped_seen) + " records\n";
+            dropped_.fetch_add(dropped - r.dropped_seen, std::memory_order_relaxed);
+            r.dropped_seen = dropped;
+        }
+    }
+
+    void format(const ring &r, const record &rec, std::string &out) {
+        char number[32];
+        auto append = [&](auto value) {
+            auto [end, ec] = std::to_chars(number, number + sizeof number, value);
+            out.append(number, end);
+        };
+
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(rec.time - start_).count();
+        out += '[';
+        append(us / 1'000'000);
+        out += '.';
+        auto frac = std::to_string(us % 1'000'000);
+        out.append(6 - frac.size(), '0');
+        out += frac;
+        out += " t";
+        append(r.thread);
+        out += "] ";
+
+        std::string_view f = rec.format;
+        std::size_t next = 0;
+        for (std::size_t at; (at = f.find("{}")) != std::string_view::npos;) {
+            out.append(f.substr(0, at));
+            f.remove_prefix(at + 2);
+            if (next == rec.count) {
+                out += "{}";
+                continue;
+            }
+            auto &a = rec.args[next++];
+            switch (a.k) {
+            case arg::kind::i64: append(a.i); break;
+            case arg::kind::u64: append(a.u); break;
+            case arg::kind::f64: append(a.d); break;
+            case arg::kind::boolean: out += a.u ? "true" : "false"; break;
+            case arg::kind::text: out.append(a.text, a.length); break;
+            }
+        }
+        out.append(f);
+        out += '\n';
+    }
+
+    std::FILE *sink_;
+    std::size_t capacity_;
+    std::chrono::milliseconds interval_;
+    std::uint64_t id_;
+    std::chrono::steady_clock::time_point start_;
+
+    std::mutex lock_; // rings_ and stopping_
+    std::condition_variable wake_;
+    std::vector<std::unique_ptr<ring>> rings_;
+    bool stopping_ = false;
+    std::atomic<bool> nudged_{false}; // a ring is half full
+
+    std::atomic<std::uint64_t> written_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::thread writer_; // last, so it starts once the rest is ready
+};
+
+#endif /* USING_UVW_LOGGER_H */
@@ -0,0 +1,229 @@
+#ifndef USING_UVW_TIMER_WHEEL_H
+#define USING_UVW_TIMER_WHEEL_H
+
+// a hierarchical timing wheel (Varghese and Lauck): levels of 64 slots,
+// each slot of a level as long as the whole level below, so five levels
+// cover 2^30 ticks. a timer sits in the slot of the lowest level whose
+// span reaches its deadline; when time enters a slot of an upper level,
+// its timers move down to finer slots, and a level 0 slot fires whole.
+// arming, re-arming and cancelling unlink or link one list node, O(1)
+// however many timers there are
+//
+// the wheel has no clock: time is a tick count handed to advance(), so
+// a simulated clock drives it as well as a loop timer does (loop_timers
+// in connection.hh). next_event() says when the next slot needs looking
+// at, so a driver sleeps until then rather than waking every tick
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <utility>
+
+class timer_wheel;
+
+// a node of a slot's list; lists are circular, with the slot's own link
+// as the head
+struct wheel_link {
+    wheel_link *prev = nullptr;
+    wheel_link *next = nullptr;
+};
+
+// a deadline on a timer_wheel, usually a member of what it times out.
+// fire runs at most once per arming, from advance()
+class wheel_timer : private wheel_link {
+public:
+    using fire_fn = std::function<void()>;
+
+    wheel_timer() = default;
+    explicit wheel_timer(fire_fn fire) : fire_(std::move(fire)) {}
+    inline ~wheel_timer();
+
+    wheel_timer(const wheel_timer &) = delete;
+    wheel_timer &operator=(const wheel_timer &) = delete;
+
+    void on_fire(fire_fn fire) { fire_ = std::move(fire); }
+
+    bool armed() const { return next != nullptr; }
+    std::uint64_t deadline() const { return deadline_; }
+
+private:
+    friend class timer_wheel;
+
+    timer_wheel *wheel_ = nullptr;
+    std::uint64_t deadline_ = 0;
+    std::uint8_t level_ = 0;
+    std::uint8_t slot_ = 0;
+    fire_fn fire_;
+};
+
+class timer_wheel {
+public:
+    static constexpr int slot_bits = 6;
+    static constexpr int levels = 5;
+    static constexpr std::size_t slots = std::size_t{1} << slot_bits;
+
+    explicit timer_wheel(std::uint64_t now = 0) : now_(now) {
+        for (auto &level : slots_) {
+            for (auto &head : level) head.prev = head.next = &head;
+        }
+    }
+
+    // timers still armed are left unarmed
+    ~timer_wheel() {
+        for (auto &level : slots_) {
+            for (auto &head : level) {
+                while (head.next != &head) unlink(timer_of(head.next));
+            }
+        }
+    }
+
+    timer_wheel(const timer_wheel &) = delete;
+    timer_wheel &operator=(const timer_wheel &) = delete;
+
+    // (re)arms timer to fire once the wheel reaches deadline; a deadline
+    // already passed fires on the next tick
+    void arm(wheel_timer &timer, std::uint64_t deadline) {
+        if (timer.armed()) timer.wheel_->unlink(timer);
+        timer.wheel_ = this;
+        timer.deadline_ = std::max(deadline, now_ + 1);
+        place(timer);
+        ++size_;
+    }
+
+    void cancel(wheel_timer &timer) {
+        if (timer.armed() && timer.wheel_ == this) unlink(timer);
+    }
+
+    // moves time to now, firing every timer due by then in deadline order
+    // (those due on the same tick in no particular order); returns how
+    // many fired. fire may arm and cancel timers, this one included
+    std::size_t advance(std::uint64_t now) {
+        std::size_t fired = 0;
+        for (auto next = next_event(); next && *next <= now; next = next_event()) {
+            now_ = *next;
+            fired += tick();
+        }
+        now_ = std::max(now_, now);
+        return fired;
+    }
+
+    // the first tick at which advance() has work to do: a timer to fire,
+    // or one to move down a level; none when nothing is armed
+    std::optional<std::uint64_t> next_event() const {
+        std::optional<std::uint64_t> first;
+        for (int level = 0; level < levels; ++level) {
+            if (occupied_[level] == 0) continue;
+            auto shift = level * slot_bits;
+            auto current = (now_ >> shift) & (slots - 1);
+            // slots after the current one, wrapping; the current one comes
+            // round again only after a full turn
+            auto ahead = std::rotr(occupied_[level], static_cast<int>((current + 1) % slots));
+            auto distance = static_cast<std::uint64_t>(std::countr_zero(ahead)) + 1;
+            auto at = ((now_ >> shift) + distance) << shift;
+            if (!first || at < *first) first = at;
+        }
+        return first;
+    }
+
+    std::uint64_t now() const { return now_; }
+    std::size_t size() const { return size_; }
+
+private:
+    friend class wheel_timer;
+
+    static wheel_timer &timer_of(wheel_link *link) { return static_cast<wheel_timer &>(*link); }
+
+    // takes link off whatever list it is on
+    static void splice_out(wheel_link &link) {
+        link.prev->next = link.next;
+        link.next->prev = link.prev;
+    }
+
+    void place(wheel_timer &timer) {
+        auto delta = timer.deadline_ - now_;
+        // the lowest level whose span covers delta; past the top one,
+        // the top level's current slot, which comes round a full turn
+        // from now and places the timer again
+        int level = delta == 0 ? 0 : (std::bit_width(delta) - 1) / slot_bits;
+        auto slot = level < levels ? (timer.deadline_ >> (level * slot_bits)) & (slots - 1)
+                                   : (now_ >> ((levels - 1) * slot_bits)) & (slots - 1);
+        level = std::min(level, levels - 1);
+
+        auto &head = slots_[level][slot];
+        timer.level_ = static_cast<std::uint8_t>(level);
+        timer.slot_ = static_cast<std::uint8_t>(slot);
+        timer.prev = head.prev;
+        timer.next = &head;
+        head.prev->next = &timer;
+        head.prev = &timer;
+        occupied_[level] |= std::uint64_t{1} << slot;
+    }
+
+    void unlink(wheel_timer &timer) {
+        splice_out(timer);
+        timer.prev = timer.next = nullptr;
+        --size_;
+        auto &head = slots_[timer.level_][timer.slot_];
+        if (head.next == &head) occupied_[timer.level_] &= ~(std::uint64_t{1} << timer.slot_);
+    }
+
+    // takes the whole list of a slot off it, onto a local head
+    void detach(int level, std::size_t slot, wheel_link &into) {
+        auto &head = slots_[level][slot];
+        occupied_[level] &= ~(std::uint64_t{1} << slot);
+        if (head.next == &head) {
+            into.prev = into.next = &into;
+            return;
+        }
+        into.next = head.next;
+        into.prev = head.prev;
+        into.next->prev = &into;
+        into.prev->next = &into;
+        head.prev = head.next = &head;
+    }
+
+    // now_ has just reached a slot boundary: move the timers of every
+    // upper level starting a slot here down, highest first, then fire
+    // level 0's slot
+    std::size_t tick() {
+        int top = 0;
+        while (top + 1 < levels && (now_ & ((std::uint64_t{1} << ((top + 1) * slot_bits)) - 1)) == 0) ++top;
+        for (int level = top; level > 0; --level) {
+            wheel_link moving;
+            detach(level, (now_ >> (level * slot_bits)) & (slots - 1), moving);
+            while (moving.next != &moving) {
+                auto &timer = timer_of(moving.next);
+                splice_out(timer);
+                place(timer);
+            }
+        }
+
+        // a fire may cancel a timer still on the local list, so take one
+        // at a time rather than walking it
+        wheel_link due;
+        detach(0, now_ & (slots - 1), due);
+        std::size_t fired = 0;
+        while (due.next != &due) {
+            auto &timer = timer_of(due.next);
+            splice_out(timer);
+            timer.prev = timer.next = nullptr;
+            --size_;
+            ++fired;
+            if (timer.fire_) timer.fire_();
+        }
+        return fired;
+    }
+
+    std::uint64_t now_;
+    std::size_t size_ = 0;
+    std::uint64_t occupied_[levels] = {}; // a bit per non-empty slot
+    wheel_link slots_[levels][slots];
+};
+
+inline wheel_timer::~wheel_timer() {
+    if (armed() && wheel_) wheel_->cancel(*this);
+}
+
+#endif /* USING_UVW_TIMER_WHEEL_H */
@@ -0,0 +1,124 @@
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <print> // C++23
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "timer-wheel.hh"
+
+// wheel-check [seed]
+//
+// drives a timer_wheel from a simulated clock and checks it against a
+// naive model, a deadline per timer, after every step: random arm,
+// re-arm, cancel and advance, with deadlines and jumps from one tick to
+// well past the wheel's 2^30 ticks, starting near a 2^30 boundary as
+// well as at zero; fire callbacks re-arm themselves and cancel other
+// timers. each timer must fire exactly on its deadline, armed() and
+// size() must match the model, and next_event() must never be later
+// than the first deadline. exits with a non-zero status on a mismatch
+
+using namespace std;
+
+namespace {
+    constexpr size_t timers = 1000;
+    constexpr size_t steps = 5000;
+    constexpr uint64_t top = uint64_t{1} << (timer_wheel::levels * timer_wheel::slot_bits);
+
+    size_t failures = 0;
+
+    void check(bool ok, string_view what, uint64_t now) {
+        if (ok) return;
+        if (++failures <= 10) println(stderr, "FAIL at {}: {}", now, what);
+    }
+
+    // one run of the model from a start time
+    void run(uint64_t start, mt19937_64 &rng) {
+        timer_wheel wheel(start);
+        vector<unique_ptr<wheel_timer>> wt;
+        vector<uint64_t> due(timers, 0); // the model: 0 is unarmed
+        uint64_t now = start;
+
+        for (size_t i = 0; i < timers; ++i) {
+            wt.push_back(make_unique<wheel_timer>());
+            wt[i]->on_fire([&, i] {
+                check(due[i] == wheel.now(), "fired off its deadline", wheel.now());
+                due[i] = 0;
+                switch (rng() % 10) {
+                case 0: { // re-arm itself
+                    auto d = wheel.now() + 1 + rng() % 5000;
+                    wheel.arm(*wt[i], d);
+                    due[i] = d;
+                    break;
+                }
+                case 1: { // cancel another, possibly due on this same tick
+                    auto j = rng() % timers;
+                    wheel.cancel(*wt[j]);
+                    due[j] = 0;
+                    break;
+                }
+                default:
+                    break;
+                }
+            });
+        }
+
+        // deadlines within each level, and past the top one
+        const array<uint64_t, 6> spans{64, 4096, 300'000, uint64_t{1} << 26, top, top * 4};
+        for (size_t step = 0; step < steps; ++step) {
+            auto i = rng() % timers;
+            switch (rng() % 4) {
+            case 0:
+            case 1: {
+                auto d = now + rng() % spans[rng() % spans.size()];
+                wheel.arm(*wt[i], d);
+                due[i] = max(d, now + 1);
+                break;
+            }
+            case 2:
+                wheel.cancel(*wt[i]);
+                due[i] = 0;
+                break;
+            default: {
+                auto roll = rng() % 100;
+                auto by = roll < 70 ? rng() % 100 : roll < 95 ? rng() % (uint64_t{1} << 27) : top + rng() % top;
+                now += by;
+                wheel.advance(now);
+                check(wheel.now() == now, "now() after advance", now);
+                for (auto d : due) check(d == 0 || d > now, "timer not fired by its deadline", now);
+                break;
+            }
+            }
+
+            size_t armed = 0;
+            optional<uint64_t> first;
+            for (size_t k = 0; k < timers; ++k) {
+                check(wt[k]->armed() == (due[k] != 0), "armed() against the model", now);
+                if (due[k] == 0) continue;
+                ++armed;
+                first = first ? min(*first, due[k]) : due[k];
+            }
+            check(wheel.size() == armed, "size() against the model", now);
+            auto next = wheel.next_event();
+            check(next.has_value() == first.has_value(), "next_event() with nothing armed", now);
+            if (next && first) check(*next > now && *next <= *first, "next_event() past a deadline", now);
+        }
+
+        now += top * 8;
+        wheel.advance(now);
+        check(wheel.size() == 0, "timers left after the last advance", now);
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    auto seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : 42;
+    mt19937_64 rng(seed);
+    for (uint64_t start : {uint64_t{0}, top - 5, uint64_t{1} << 40, rng() % top}) run(start, rng);
+    println("seed {}: {}", seed, failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
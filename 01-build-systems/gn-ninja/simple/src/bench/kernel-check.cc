@@ -0,0 +1,72 @@
+// checks every sum_i32 kernel the running cpu supports, and the
+// dispatched ss::detail::sum_i32, against the scalar reference: every
+// length up to 64, so each vector loop's tail is hit at every offset,
+// then long odd lengths, with random and extreme (all INT_MAX, all
+// INT_MIN) inputs; exits with a non-zero status on any mismatch
+//
+// usage: kernel-check
+#include "kernels.hh"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <print>  // C++23, not available in g++; use clang++17 or higher
+#include <random>
+#include <string_view>
+#include <vector>
+
+namespace {
+  using namespace std;
+
+  auto fill(string_view shape, size_t n, mt19937& rng) -> vector<int> {
+    vector<int> data(n);
+    if (shape == "max") {
+      ranges::fill(data, INT_MAX);
+    } else if (shape == "min") {
+      ranges::fill(data, INT_MIN);
+    } else if (shape == "alternating") {
+      for (size_t i = 0; i < n; ++i) data[i] = i % 2 ? INT_MIN : INT_MAX;
+    } else {
+      uniform_int_distribution<int> dist(INT_MIN, INT_MAX);
+      for (auto& v : data) v = dist(rng);
+    }
+    return data;
+  }
+}
+
+auto main() -> int {
+  vector<size_t> lengths;
+  for (size_t n = 0; n <= 64; ++n) lengths.push_back(n);
+  for (size_t n : {127, 1'001, 4'097, 65'537, 1'000'003}) lengths.push_back(n);
+
+  auto kernels = ss::detail::sum_i32_kernels();
+  print("kernels:");
+  for (auto& k : kernels) print(" {}", k.name);
+  println(", dispatched: {}", ss::detail::sum_i32_kernel_name());
+
+  mt19937 rng(42);
+  size_t checks = 0, failures = 0;
+  for (auto shape : {"random", "max", "min", "alternating"}) {
+    for (auto n : lengths) {
+      auto data = fill(shape, n, rng);
+      // from an unaligned start too, so loads straddle vector boundaries
+      for (size_t offset : {0, 1}) {
+        if (offset > n) continue;
+        auto p = data.data() + offset;
+        auto count = n - offset;
+        auto expected = ss::detail::sum_i32_scalar(p, count);
+        auto check = [&](string_view name, int64_t got) {
+          ++checks;
+          if (got == expected) return;
+          ++failures;
+          println(stderr, "{}: {} n={} offset={}: got {}, expected {}", name, shape, count, offset, got,
+                  expected);
+        };
+        for (auto& k : kernels) check(k.name, k.fn(p, count));
+        check("dispatched", ss::detail::sum_i32(p, count));
+      }
+    }
+  }
+  println("{} checks, {} failures", checks, failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
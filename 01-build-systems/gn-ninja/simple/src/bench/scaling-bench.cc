@@ -0,0 +1,68 @@
+// strong scaling of the ss::parallel functions: the same data summed,
+// summarized and reduced to a median with 1, 2, 4, ... threads up to
+// the hardware concurrency (or the given maximum)
+//
+// usage: scaling-bench [samples] [max threads] [repetitions]
+#include "parallel-stats.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <print>  // C++23, not available in g++; use clang++17 or higher
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+  using namespace std;
+  using clock_type = chrono::steady_clock;
+
+  // best of reps, in seconds; the best run is the one least disturbed
+  // by the rest of the machine
+  auto best_of(size_t reps, const function<void()>& fn) -> double {
+    auto best = numeric_limits<double>::max();
+    for (size_t r = 0; r < reps; ++r) {
+      auto t0 = clock_type::now();
+      fn();
+      best = min(best, chrono::duration<double>(clock_type::now() - t0).count());
+    }
+    return best;
+  }
+}
+
+auto main(int argc, char** argv) -> int {
+  size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : size_t{1} << 27;
+  size_t max_threads = argc > 2 ? strtoull(argv[2], nullptr, 10) : max(1u, thread::hardware_concurrency());
+  size_t reps = argc > 3 ? strtoull(argv[3], nullptr, 10) : 5;
+
+  ss::voi data(n);
+  mt19937_64 rng(42);
+  for (auto& v : data) v = static_cast<int>(rng());
+
+  vector<size_t> counts;
+  for (size_t t = 1; t < max_threads; t *= 2) counts.push_back(t);
+  counts.push_back(max_threads);
+
+  auto gib = static_cast<double>(n * sizeof(int)) / (1 << 30);
+  println("n={} ({:.2f} GiB), best of {}", n, gib, reps);
+  println("{:>7} {:>12} {:>8} {:>12} {:>8} {:>12} {:>8}",
+          "threads", "sum GiB/s", "speedup", "summ. GiB/s", "speedup", "median ms", "speedup");
+
+  double base_sum = 0, base_summary = 0, base_median = 0;
+  volatile double sink = 0;
+  for (auto t : counts) {
+    ss::parallel::set_max_threads(t);
+    auto s = best_of(reps, [&] { sink = sink + ss::parallel::sum(data); });
+    auto m = best_of(reps, [&] { sink = sink + ss::parallel::summarize(data).stddev; });
+    auto q = best_of(reps, [&] { sink = sink + ss::parallel::median(data); });
+    if (t == 1) {
+      base_sum = s;
+      base_summary = m;
+      base_median = q;
+    }
+    println("{:>7} {:>12.2f} {:>8.2f} {:>12.2f} {:>8.2f} {:>12.2f} {:>8.2f}",
+            t, gib / s, base_sum / s, gib / m, base_summary / m, q * 1e3, base_median / q);
+  }
+}
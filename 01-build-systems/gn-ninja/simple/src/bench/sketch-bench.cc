@@ -0,0 +1,106 @@
+// throughput and accuracy of ss::quantile_sketch against the exact
+// answers from ss::median and a full sort of the same data; exits with
+// a non-zero status when any estimate is outside the sketch's bound
+//
+// usage: sketch-bench [samples] [k]
+#include "quantile-sketch.hh"
+#include "simple-stats.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <print>  // C++23, not available in g++; use clang++17 or higher
+#include <random>
+#include <span>
+#include <string_view>
+
+namespace {
+  using namespace std;
+  using clock_type = chrono::steady_clock;
+
+  auto make_data(string_view shape, size_t n) -> ss::voi {
+    mt19937_64 rng(42);
+    ss::voi data(n);
+    if (shape == "uniform") {
+      uniform_int_distribution<int> dist(-1'000'000, 1'000'000);
+      for (auto& v : data) v = dist(rng);
+    } else if (shape == "skewed") {
+      lognormal_distribution<double> dist(8.0, 1.5);
+      for (auto& v : data) v = static_cast<int>(min(dist(rng), 2e9));
+    } else {
+      for (size_t i = 0; i < n; ++i) data[i] = static_cast<int>(i);
+    }
+    return data;
+  }
+
+  // distance from q to the range of normalized ranks value occupies in
+  // the sorted data; zero when value is a correct answer for q
+  auto rank_error(const ss::voi& sorted, double value, double q) -> double {
+    auto n = static_cast<double>(sorted.size());
+    auto lo = ranges::lower_bound(sorted, value) - sorted.begin();
+    auto hi = ranges::upper_bound(sorted, value) - sorted.begin();
+    return max({0.0, lo / n - q, q - hi / n});
+  }
+
+  auto ns_per(clock_type::duration elapsed, size_t n) -> double {
+    return chrono::duration<double, nano>(elapsed).count() / n;
+  }
+}
+
+auto main(int argc, char** argv) -> int {
+  size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10'000'000;
+  auto k = static_cast<uint16_t>(argc > 2 ? atoi(argv[2]) : 200);
+  constexpr size_t shards = 8;
+  constexpr double qs[] = {0.01, 0.25, 0.5, 0.75, 0.99, 0.999};
+
+  bool ok = true;
+  for (auto shape : {"uniform", "skewed", "sorted"}) {
+    auto data = make_data(shape, n);
+
+    // single stream
+    ss::quantile_sketch sketch(k);
+    auto t0 = clock_type::now();
+    sketch.add(span<const int>(data));
+    auto add_ns = ns_per(clock_type::now() - t0, n);
+
+    // per-shard sketches combined through the wire format
+    ss::quantile_sketch merged(k);
+    t0 = clock_type::now();
+    for (size_t s = 0; s < shards; ++s) {
+      ss::quantile_sketch shard(k);
+      auto begin = n * s / shards, end = n * (s + 1) / shards;
+      shard.add(span<const int>(data).subspan(begin, end - begin));
+      auto restored = ss::quantile_sketch::deserialize(shard.serialize());
+      if (!restored) {
+        println(stderr, "{}: shard {} did not survive serialization", shape, s);
+        return EXIT_FAILURE;
+      }
+      merged.merge(*restored);
+    }
+    auto merge_ns = ns_per(clock_type::now() - t0, n);
+
+    auto copy = data;
+    t0 = clock_type::now();
+    auto exact_median = ss::median(copy);
+    auto median_ns = ns_per(clock_type::now() - t0, n);
+
+    ranges::sort(data);
+    println("{:>8}: n={} k={} retained={} bytes={} bound={:.4f}",
+            shape, n, k, sketch.retained(), sketch.serialize().size(), sketch.rank_error());
+    println("          add {:.2f} ns/elem, shard+merge {:.2f} ns/elem, exact median {:.2f} ns/elem",
+            add_ns, merge_ns, median_ns);
+    println("          median: exact {:.1f} sketch {:.1f} merged {:.1f}",
+            exact_median, sketch.quantile(0.5), merged.quantile(0.5));
+
+    for (auto q : qs) {
+      auto single = rank_error(data, sketch.quantile(q), q);
+      auto combined = rank_error(data, merged.quantile(q), q);
+      auto pass = single <= sketch.rank_error() && combined <= merged.rank_error();
+      ok = ok && pass;
+      println("          q={:<6} rank error {:.5f} (merged {:.5f}) {}",
+              q, single, combined, pass ? "ok" : "FAIL");
+    }
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,319 @@
+// per-element cost of every ss entry point, from inputs that fit in L1
+// to inputs well past the last-level cache, over sorted, uniformly random
+// and skewed data. built twice, against ss-static and ss-shared, so the
+// two link modes can be compared run for run: the difference is what
+// calling through the PLT into default-visibility STATS_API symbols costs
+//
+// each case is timed over repeated samples, every sample long enough
+// (about a millisecond) to swamp the clock; percentiles are over samples
+//
+// usage: ss-bench [--json] [--max-bytes N] [--reps N] [--filter text]
+//   --max-bytes  largest int input, in bytes (default 8x LLC, 64 MiB
+//                to 512 MiB)
+//   --reps       samples per case (default 21; cases stop early after
+//                about a second once they have 5)
+//   --filter     only cases whose name contains text
+#include "group-aggregate.hh"
+#include "parallel-stats.hh"
+#include "quantile-sketch.hh"
+#include "rolling.hh"
+#include "running-stats.hh"
+#include "series-stats.hh"
+#include "simple-stats.hh"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <print>  // C++23, not available in g++; use clang++17 or higher
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+  using namespace std;
+  using clock_type = chrono::steady_clock;
+
+  constexpr string_view link_mode = STATS_API_IS_DLL ? "shared" : "static";
+  constexpr size_t min_bytes = 4096;
+  constexpr double sample_seconds = 1e-3;
+  constexpr double case_seconds = 1.0;
+  constexpr size_t min_reps = 5;
+
+  // one field out of a wider record, for the strided entry points
+  struct row {
+    double value;
+    int64_t tag;
+  };
+
+  // summarize_series cuts the ints into series of this many samples
+  constexpr size_t series_length = 32;
+
+  // group_aggregate keys are the ints folded onto this many groups
+  constexpr int64_t group_count = 4096;
+
+  struct inputs {
+    ss::voi ints;
+    vector<size_t> offsets;
+    vector<double> doubles;
+    vector<row> rows;
+    vector<int64_t> keys;
+  };
+
+  enum class input { ints, doubles, rows, keyed };
+
+  struct bench_case {
+    string_view name;
+    input kind;
+    function<double(inputs&)> run;  // returns something to keep alive
+  };
+
+  auto cache_bytes(int level) -> size_t {
+#if defined(__APPLE__)
+    const char* names[] = {"", "hw.l1dcachesize", "hw.l2cachesize", "hw.l3cachesize"};
+    int64_t bytes = 0;
+    auto len = sizeof bytes;
+    if (sysctlbyname(names[level], &bytes, &len, nullptr, 0) != 0) return 0;
+    return static_cast<size_t>(bytes);
+#elif defined(_SC_LEVEL3_CACHE_SIZE)
+    const int names[] = {0, _SC_LEVEL1_DCACHE_SIZE, _SC_LEVEL2_CACHE_SIZE, _SC_LEVEL3_CACHE_SIZE};
+    return static_cast<size_t>(max(0L, sysconf(names[level])));
+#else
+    return 0;
+#endif
+  }
+
+  auto last_level_cache() -> size_t {
+    for (int level = 3; level > 0; --level) {
+      if (auto bytes = cache_bytes(level)) return bytes;
+    }
+    return size_t{8} << 20;
+  }
+
+  auto make_ints(string_view shape, size_t n) -> ss::voi {
+    mt19937_64 rng(42);
+    ss::voi data(n);
+    if (shape == "random") {
+      for (auto& v : data) v = static_cast<int>(rng());
+    } else if (shape == "skewed") {
+      // most values small, a long tail of large ones
+      lognormal_distribution<double> dist(8.0, 1.5);
+      for (auto& v : data) v = static_cast<int>(min(dist(rng), 2e9));
+    } else {
+      for (size_t i = 0; i < n; ++i) data[i] = static_cast<int>(i);
+    }
+    return data;
+  }
+
+  auto cases() -> vector<bench_case> {
+    static constexpr array<double, 3> qs = {0.01, 0.5, 0.99};
+    static array<double, 3> out;
+    auto strided = [](const inputs& in) {
+      return ss::strided_span<double>(&in.rows[0].value, in.rows.size(), sizeof(row));
+    };
+
+    return {
+      {"ss::sum", input::ints, [](inputs& in) { return double(ss::sum(in.ints)); }},
+      {"ss::average", input::ints, [](inputs& in) { return ss::average(in.ints); }},
+      {"ss::summarize", input::ints, [](inputs& in) { return ss::summarize(in.ints).stddev; }},
+      {"ss::median", input::ints, [](inputs& in) { return ss::median(in.ints); }},
+      {"ss::quantiles", input::ints, [](inputs& in) {
+        ss::quantiles(in.ints, qs, out);
+        return out[0];
+      }},
+      {"ss::running_stats::push", input::ints, [](inputs& in) {
+        ss::running_stats stats;
+        stats.push(in.ints);
+        return double(stats.sum());
+      }},
+      {"ss::quantile_sketch::add", input::ints, [](inputs& in) {
+        ss::quantile_sketch sketch;
+        sketch.add(in.ints);
+        return double(sketch.retained());
+      }},
+      {"ss::rolling::push", input::ints, [](inputs& in) {
+        ss::rolling window(1024);
+        for (auto v : in.ints) window.push(v);
+        return window.median();
+      }},
+      {"ss::summarize_series", input::ints, [](inputs& in) {
+        static vector<int64_t> sums;
+        static vector<double> means, medians;
+        auto count = in.offsets.size() - 1;
+        sums.resize(count);
+        means.resize(count);
+        medians.resize(count);
+        ss::summarize_series(in.ints, in.offsets, {sums, means, medians});
+        return medians[0];
+      }},
+      {"ss::parallel::sum", input::ints, [](inputs& in) { return double(ss::parallel::sum(in.ints)); }},
+      {"ss::parallel::summarize", input::ints, [](inputs& in) {
+        return ss::parallel::summarize(in.ints).stddev;
+      }},
+      {"ss::parallel::median", input::ints, [](inputs& in) { return ss::parallel::median(in.ints); }},
+      {"ss::parallel::quantiles", input::ints, [](inputs& in) {
+        ss::parallel::quantiles(in.ints, qs, out);
+        return out[0];
+      }},
+      {"ss::sum<double>", input::doubles, [](inputs& in) {
+        return ss::sum(span<const double>(in.doubles));
+      }},
+      {"ss::summarize<double>", input::doubles, [](inputs& in) {
+        return ss::summarize(span<const double>(in.doubles)).stddev;
+      }},
+      {"ss::median<double>", input::doubles, [](inputs& in) {
+        return ss::median(span<const double>(in.doubles));
+      }},
+      {"ss::sum<strided>", input::rows, [=](inputs& in) { return ss::sum(strided(in)); }},
+      {"ss::summarize<strided>", input::rows, [=](inputs& in) { return ss::summarize(strided(in)).stddev; }},
+      {"ss::median<strided>", input::rows, [=](inputs& in) { return ss::median(strided(in)); }},
+      {"ss::group_aggregate::add", input::keyed, [](inputs& in) {
+        ss::int_group_aggregate groups;
+        groups.add(in.keys, in.ints);
+        return double(groups.size());
+      }},
+    };
+  }
+
+  auto bytes_per_element(input kind) -> size_t {
+    switch (kind) {
+      case input::ints: return sizeof(int);
+      case input::doubles: return sizeof(double);
+      case input::rows: return sizeof(double);  // only the field is read
+      case input::keyed: return sizeof(int64_t) + sizeof(int);
+    }
+    return 0;
+  }
+
+  auto percentile(const vector<double>& sorted, double p) -> double {
+    auto rank = static_cast<size_t>(ceil(p * sorted.size()));
+    return sorted[min(sorted.size(), max<size_t>(rank, 1)) - 1];
+  }
+
+  struct result {
+    size_t reps;
+    size_t iterations;  // calls per sample
+    double min, p50, p90, p99;  // ns per element
+  };
+
+  // samples of ns per element; calls are batched so that each sample runs
+  // for about sample_seconds, however small the input
+  auto measure(const bench_case& c, inputs& in, size_t n, size_t reps) -> result {
+    volatile double sink = 0;
+    auto t0 = clock_type::now();
+    sink = sink + c.run(in);
+    auto once = max(1e-9, chrono::duration<double>(clock_type::now() - t0).count());
+    auto iterations = max<size_t>(1, static_cast<size_t>(sample_seconds / once));
+
+    vector<double> samples;
+    auto started = clock_type::now();
+    while (samples.size() < reps) {
+      auto t = clock_type::now();
+      for (size_t i = 0; i < iterations; ++i) sink = sink + c.run(in);
+      auto seconds = chrono::duration<double>(clock_type::now() - t).count();
+      samples.push_back(seconds * 1e9 / (static_cast<double>(iterations) * max<size_t>(n, 1)));
+
+      auto spent = chrono::duration<double>(clock_type::now() - started).count();
+      if (samples.size() >= min_reps && spent > case_seconds) break;
+    }
+
+    ranges::sort(samples);
+    return {samples.size(), iterations, samples.front(), percentile(samples, 0.5),
+            percentile(samples, 0.9), percentile(samples, 0.99)};
+  }
+
+  auto option(int argc, char** argv, string_view name) -> const char* {
+    for (int i = 1; i + 1 < argc; ++i) {
+      if (argv[i] == name) return argv[i + 1];
+    }
+    return nullptr;
+  }
+}
+
+auto main(int argc, char** argv) -> int {
+  auto json = any_of(argv + 1, argv + argc, [](const char* a) { return a == string_view("--json"); });
+  auto llc = last_level_cache();
+  size_t max_bytes = clamp(8 * llc, size_t{64} << 20, size_t{512} << 20);
+  if (auto v = option(argc, argv, "--max-bytes")) max_bytes = max<size_t>(strtoull(v, nullptr, 10), min_bytes);
+  size_t reps = 21;
+  if (auto v = option(argc, argv, "--reps")) reps = max<size_t>(strtoull(v, nullptr, 10), 1);
+  string_view filter = option(argc, argv, "--filter") ? option(argc, argv, "--filter") : "";
+
+  // powers of four from a page, which fits in any L1, up to max_bytes
+  vector<size_t> sizes;
+  for (auto bytes = min_bytes; bytes < max_bytes; bytes *= 4) sizes.push_back(bytes);
+  sizes.push_back(max_bytes);
+
+  auto all = cases();
+  if (json) {
+    println("{{");
+    println("  \"link\": \"{}\",", link_mode);
+    println("  \"l1d_bytes\": {},", cache_bytes(1));
+    println("  \"llc_bytes\": {},", llc);
+    println("  \"threads\": {},", ss::parallel::max_threads());
+    println("  \"results\": [");
+  } else {
+    println("link={} L1d={} KiB LLC={} KiB threads={}", link_mode, cache_bytes(1) >> 10, llc >> 10,
+            ss::parallel::max_threads());
+    println("{:<26} {:>8} {:>11} {:>5} {:>9} {:>9} {:>9} {:>9} {:>8}",
+            "function", "shape", "int bytes", "reps", "min ns/e", "p50 ns/e", "p90 ns/e", "p99 ns/e", "p50 GB/s");
+  }
+
+  auto first = true;
+  for (auto bytes : sizes) {
+    for (string_view shape : {"sorted", "random", "skewed"}) {
+      inputs in;
+      in.ints = make_ints(shape, bytes / sizeof(int));
+      auto n = in.ints.size();
+      for (size_t i = 0; i < n; i += series_length) in.offsets.push_back(i);
+      in.offsets.push_back(n);
+      for (auto kind : {input::ints, input::doubles, input::rows, input::keyed}) {
+        // build each input only while its cases run, to bound memory
+        if (kind == input::doubles) in.doubles.assign(in.ints.begin(), in.ints.end());
+        if (kind == input::rows) {
+          vector<double>().swap(in.doubles);
+          in.rows.resize(n);
+          for (size_t i = 0; i < n; ++i) in.rows[i] = {static_cast<double>(in.ints[i]), int64_t(i)};
+        }
+        if (kind == input::keyed) {
+          vector<row>().swap(in.rows);
+          in.keys.resize(n);
+          for (size_t i = 0; i < n; ++i) in.keys[i] = in.ints[i] % group_count;
+        }
+
+        for (auto& c : all) {
+          if (c.kind != kind || c.name.find(filter) == string_view::npos) continue;
+          auto r = measure(c, in, n, reps);
+          auto gbps = bytes_per_element(kind) / r.p50;  // bytes per ns is GB/s
+          if (json) {
+            print("{}    {{\"function\": \"{}\", \"shape\": \"{}\", \"elements\": {}, \"bytes\": {}, "
+                    "\"reps\": {}, \"iterations\": {}, \"ns_per_element\": {{\"min\": {:.4f}, "
+                    "\"p50\": {:.4f}, \"p90\": {:.4f}, \"p99\": {:.4f}}}, \"gb_per_s\": {:.3f}}}",
+                    first ? "" : ",\n", c.name, shape, n, n * bytes_per_element(kind), r.reps,
+                    r.iterations, r.min, r.p50, r.p90, r.p99, gbps);
+            first = false;
+          } else {
+            println("{:<26} {:>8} {:>11} {:>5} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f} {:>8.2f}",
+                    c.name, shape, bytes, r.reps, r.min, r.p50, r.p90, r.p99, gbps);
+          }
+        }
+      }
+    }
+  }
+
+  if (json) {
+    println("");
+    println("  ]");
+    println("}}");
+  }
+}
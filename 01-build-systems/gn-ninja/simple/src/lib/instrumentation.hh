@@ -0,0 +1,78 @@
+#ifndef SIMPLE_STATS_INSTRUMENTATION_H
+#define SIMPLE_STATS_INSTRUMENTATION_H
+
+#include "simple-stats.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// call counts, element counts and latency histograms of the ss entry
+// points, for seeing where a service's time goes without a profiler
+//
+// probes are only compiled into the library when it is built with
+// STATS_API_INSTRUMENT=1 (gn: ss_instrument = true, meson:
+// -Dinstrument=true); otherwise they are empty statements and every call
+// below reports nothing. the functions here are always exported, so
+// callers link the same either way and can ask enabled()
+//
+// each thread counts into its own block, with plain stores that no other
+// thread writes, so a probe costs two clock reads and a few adds and
+// never contends. reading walks the blocks of every live thread, plus
+// what exited threads left behind. only the outermost call is counted:
+// average() calling sum() counts as one call to average()
+namespace ss::instrumentation {
+  /// the instrumented entry points; overloads for every sample type and
+  /// view share one probe
+  enum class probe : std::uint8_t {
+    sum,
+    average,
+    summarize,
+    median,
+    quantiles,
+    parallel_sum,
+    parallel_average,
+    parallel_summarize,
+    parallel_median,
+    parallel_quantiles,
+  };
+
+  inline constexpr std::size_t probe_count = 10;
+
+  /// histogram[b] counts calls that took [2^b, 2^(b+1)) nanoseconds;
+  /// bucket 0 also holds calls under a nanosecond, the last anything longer
+  inline constexpr std::size_t histogram_buckets = 40;
+
+  struct probe_counts {
+    probe which = probe::sum;
+    std::uint64_t calls = 0;
+    std::uint64_t elements = 0;
+    std::uint64_t total_ns = 0;
+    std::array<std::uint64_t, histogram_buckets> histogram = {};
+  };
+
+  /// "sum", "parallel::median" and so on
+  STATS_API auto name(probe p) -> std::string_view;
+
+  /// whether the library was built with probes
+  STATS_API auto enabled() -> bool;
+
+  /// the counts of every probe since start or the last reset(), summed
+  /// over all threads, in probe order
+  STATS_API auto read() -> std::vector<probe_counts>;
+  STATS_API auto read(probe p) -> probe_counts;
+
+  /// start counting from zero; calls in flight may land on either side
+  STATS_API auto reset() -> void;
+
+  /// read() as a JSON document: {"enabled": bool, "probes": [{"name",
+  /// "calls", "elements", "total_ns", "histogram_ns"}]}, listing only
+  /// probes that were called, with histogram_ns cut after its last
+  /// non-zero bucket
+  STATS_API auto to_json() -> std::string;
+}
+
+#endif /* SIMPLE_STATS_INSTRUMENTATION_H */
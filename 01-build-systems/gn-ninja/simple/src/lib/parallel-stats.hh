@@ -0,0 +1,37 @@
+#ifndef SIMPLE_STATS_PARALLEL_STATS_H
+#define SIMPLE_STATS_PARALLEL_STATS_H
+
+#include "simple-stats.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// multi-threaded counterparts of the ss functions; results match the
+// serial versions (sum and quantiles exactly, the moments in summarize
+// up to rounding)
+//
+// work runs on one pool shared by the whole library, started on first
+// use. inputs are cut into page-aligned chunks, so no cache line or page
+// is written or owned by two threads, and each thread starts on its own
+// contiguous run of chunks before it steals from the others. inputs
+// smaller than serial_threshold() skip the pool entirely.
+namespace ss::parallel {
+  /// threads a call may use, counting the caller; defaults to the
+  /// hardware concurrency, and 1 makes every call serial
+  STATS_API auto max_threads() -> std::size_t;
+  STATS_API auto set_max_threads(std::size_t n) -> void;
+
+  /// element count below which calls run serially on the caller
+  STATS_API auto serial_threshold() -> std::size_t;
+  STATS_API auto set_serial_threshold(std::size_t n) -> void;
+
+  STATS_API auto sum(std::span<const int> data) -> std::int64_t;
+  STATS_API auto average(std::span<const int> data) -> double;
+  STATS_API auto summarize(std::span<const int> data) -> summary;
+  STATS_API auto median(std::span<const int> data) -> double;
+  STATS_API auto quantiles(std::span<const int> data, std::span<const double> qs,
+                           std::span<double> out) -> void;
+}
+
+#endif /* SIMPLE_STATS_PARALLEL_STATS_H */
@@ -0,0 +1,58 @@
+#ifndef SIMPLE_STATS_PROBE_H
+#define SIMPLE_STATS_PROBE_H
+
+// internal to the ss library: SS_PROBE(name, elements) at the top of an
+// entry point counts the call under instrumentation::probe::name, and
+// compiles to nothing unless STATS_API_INSTRUMENT is set
+#include "instrumentation.hh"
+
+#if defined(STATS_API_INSTRUMENT) && STATS_API_INSTRUMENT
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace ss::detail {
+  /// adds one call to the calling thread's counters
+  auto record(instrumentation::probe p, std::uint64_t elements, std::uint64_t ns) -> void;
+
+  // nesting depth of probes on this thread; only depth 0 records
+  inline thread_local unsigned probe_depth = 0;
+
+  class probe_scope {
+  public:
+    probe_scope(instrumentation::probe p, std::size_t elements)
+        : probe_(p), elements_(elements), outer_(probe_depth++ == 0) {
+        if (outer_) start_ = std::chrono::steady_clock::now();
+    }
+
+    ~probe_scope() {
+        if (outer_) {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_).count();
+            record(probe_, elements_, static_cast<std::uint64_t>(ns));
+        }
+        --probe_depth;
+    }
+
+    probe_scope(const probe_scope&) = delete;
+    auto operator=(const probe_scope&) -> probe_scope& = delete;
+
+  private:
+    instrumentation::probe probe_;
+    std::size_t elements_;
+    bool outer_;
+    std::chrono::steady_clock::time_point start_;
+  };
+}
+
+#define SS_PROBE(name, elements) \
+  ::ss::detail::probe_scope ss_probe_scope_(::ss::instrumentation::probe::name, (elements))
+
+#else
+
+#define SS_PROBE(name, elements) static_cast<void>(0)
+
+#endif /* STATS_API_INSTRUMENT */
+
+#endif /* SIMPLE_STATS_PROBE_H */
@@ -0,0 +1,85 @@
+#ifndef SIMPLE_STATS_QUANTILE_SKETCH_H
+#define SIMPLE_STATS_QUANTILE_SKETCH_H
+
+#include "simple-stats.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace ss {
+  namespace detail { struct sketch_wire; }
+
+  /// mergeable quantile sketch (KLL: Karnin, Lang, Liberty) for streams
+  /// too large, or too spread out, for ss::median
+  ///
+  /// samples land in a level-0 buffer; when the sketch is over capacity
+  /// a full level is sorted and every other item is promoted to the next
+  /// level with twice the weight. level capacities shrink geometrically
+  /// going down, so memory is about 3k items plus a couple per level, no
+  /// matter how many samples are added. quantile answers are within
+  /// rank_error() of the true rank with high probability.
+  class STATS_API quantile_sketch {
+  public:
+    /// k trades memory for accuracy; 200 gives ~1.3% rank error
+    explicit quantile_sketch(std::uint16_t k = 200);
+
+    /// smallest k whose rank_error() is at most epsilon
+    static auto for_rank_error(double epsilon) -> quantile_sketch;
+
+    auto add(int value) -> void {
+        levels_[0].push_back(value);
+        ++n_;
+        min_ = value < min_ ? value : min_;
+        max_ = value > max_ ? value : max_;
+        if (++retained_ > limit_) compress();
+    }
+
+    auto add(std::span<const int> values) -> void;
+
+    /// fold another sketch into this one; the result answers queries as
+    /// if it had seen both inputs. sketches with different k can be
+    /// merged, and the result keeps this sketch's k. merging a sketch
+    /// into itself counts every value twice
+    auto merge(const quantile_sketch& other) -> void;
+
+    /// value at normalized rank q in [0, 1]; NaN when empty. q = 0 and
+    /// q = 1 are exact (min and max)
+    auto quantile(double q) const -> double;
+
+    auto count() const -> std::uint64_t { return n_; }
+    auto k() const -> std::uint16_t { return k_; }
+    auto retained() const -> std::size_t { return retained_; }
+
+    /// normalized rank error bound at 99% confidence for this k
+    auto rank_error() const -> double;
+
+    /// compact little-endian encoding, identical on every platform, so
+    /// sketches built in different processes can be shipped and merged
+    auto serialize() const -> std::vector<std::byte>;
+
+    /// inverse of serialize(); nullopt when bytes are truncated, from
+    /// another format version, or internally inconsistent
+    static auto deserialize(std::span<const std::byte> bytes) -> std::optional<quantile_sketch>;
+
+  private:
+    friend struct detail::sketch_wire;
+
+    auto compress() -> void;
+    auto update_limit() -> void;
+
+    std::uint16_t k_;
+    std::uint64_t n_ = 0;
+    int min_;
+    int max_;
+    std::size_t retained_ = 0;
+    std::size_t limit_ = 0;
+    std::uint64_t coin_;
+    std::vector<std::vector<int>> levels_;
+    std::vector<std::size_t> capacities_;
+  };
+}
+
+#endif /* SIMPLE_STATS_QUANTILE_SKETCH_H */
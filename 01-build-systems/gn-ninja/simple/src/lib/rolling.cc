@@ -0,0 +1,231 @@
+#include "rolling.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <utility>
+
+namespace ss {
+  using namespace std;
+
+  namespace {
+    constexpr uint32_t upper_bit = uint32_t{1} << 31;
+    constexpr size_t max_window = upper_bit - 1;
+  }
+
+  rolling::rolling(size_t window, unsigned tracked)
+      : window_(clamp<size_t>(window, 1, max_window)),
+        tracked_(tracked),
+        inverse_(1.0 / static_cast<double>(window_)),
+        ring_(window_) {
+      if (tracked_ & extremes) {
+          lows_.items.resize(window_);
+          highs_.items.resize(window_);
+      }
+      if (tracked_ & medians) {
+          // the lower half holds at most one more than the upper, and
+          // briefly one more than that before rebalancing
+          lower_.reserve(window_ / 2 + 2);
+          upper_.reserve(window_ / 2 + 2);
+          where_.resize(window_);
+      }
+  }
+
+  auto rolling::push(int value) -> void {
+      auto slot = next_;
+      next_ = static_cast<uint32_t>(wrap(next_ + 1));
+      auto full = count_ == window_;
+      auto old = exchange(ring_[slot], value);
+
+      if (tracked_ & sums) {
+          // Welford's update, and its inverse for the sample leaving
+          if (full) {
+              // the count is fixed from here on, so no more divisions
+              auto old_mean = static_cast<double>(sum_) * inverse_;
+              sum_ += static_cast<int64_t>(value) - old;
+              auto mean = static_cast<double>(sum_) * inverse_;
+              m2_ += (static_cast<double>(value) - old) * ((value - mean) + (old - old_mean));
+          } else {
+              auto old_mean = count_ > 0 ? static_cast<double>(sum_) / count_ : 0.0;
+              sum_ += value;
+              auto mean = static_cast<double>(sum_) / (count_ + 1);
+              m2_ += (value - old_mean) * (value - mean);
+          }
+      }
+      if (!full) ++count_;
+
+      if (tracked_ & extremes) {
+          slide(lows_, seq_, value, less<int>());
+          slide(highs_, seq_, value, greater<int>());
+      }
+      if (tracked_ & medians) {
+          if (full) {
+              update(slot);
+          } else {
+              insert(slot);
+          }
+      }
+      ++seq_;
+
+      // the inverse update drifts; once per lap of the ring, start over
+      // from the exact sum, which keeps the cost amortized O(1)
+      if ((tracked_ & sums) && full && slot == window_ - 1) resync();
+  }
+
+  auto rolling::push(span<const int> data, const rolling_outputs& out) -> void {
+      for (size_t i = 0; i < data.size(); ++i) {
+          push(data[i]);
+          if (!out.sum.empty()) out.sum[i] = sum();
+          if (!out.mean.empty()) out.mean[i] = mean();
+          if (!out.variance.empty()) out.variance[i] = variance();
+          if (!out.min.empty()) out.min[i] = min();
+          if (!out.max.empty()) out.max[i] = max();
+          if (!out.median.empty()) out.median[i] = median();
+      }
+  }
+
+  auto rolling::clear() -> void {
+      next_ = 0;
+      seq_ = 0;
+      count_ = 0;
+      sum_ = 0;
+      m2_ = 0.0;
+      lows_.front = lows_.size = 0;
+      highs_.front = highs_.size = 0;
+      lower_.clear();
+      upper_.clear();
+  }
+
+  auto rolling::mean() const -> double {
+      if (count_ == 0) return numeric_limits<double>::quiet_NaN();
+      return static_cast<double>(sum_) / count_;
+  }
+
+  auto rolling::variance() const -> double {
+      if (count_ == 0) return numeric_limits<double>::quiet_NaN();
+      return std::max(m2_, 0.0) / count_;
+  }
+
+  auto rolling::min() const -> int {
+      return lows_.size > 0 ? lows_.items[lows_.front].value : 0;
+  }
+
+  auto rolling::max() const -> int {
+      return highs_.size > 0 ? highs_.items[highs_.front].value : 0;
+  }
+
+  auto rolling::median() const -> double {
+      if (lower_.empty()) return numeric_limits<double>::quiet_NaN();
+      if (lower_.size() > upper_.size()) return value(lower_, 0);
+      return (static_cast<double>(value(lower_, 0)) + value(upper_, 0)) / 2;
+  }
+
+  // keeps the queue's values in strictly `before` order from the front,
+  // so the front is the extreme of the window: a new value makes every
+  // queued value it beats unreachable, and the front leaves with its sample
+  template <typename Before>
+  auto rolling::slide(queue& q, uint64_t seq, int value, Before before) -> void {
+      while (q.size > 0 && q.items[q.front].seq + window_ <= seq) {
+          q.front = wrap(q.front + 1);
+          --q.size;
+      }
+      while (q.size > 0 && !before(q.items[wrap(q.front + q.size - 1)].value, value)) --q.size;
+      q.items[wrap(q.front + q.size)] = {seq, value};
+      ++q.size;
+  }
+
+  template <bool Upper>
+  auto rolling::place(size_t i, uint32_t slot) -> void {
+      half<Upper>()[i] = slot;
+      where_[slot] = static_cast<uint32_t>(i) | (Upper ? upper_bit : 0);
+  }
+
+  // moves the slot at i up or down to where its value belongs; the lower
+  // half is a max-heap, the upper half a min-heap. the slot is carried as
+  // a hole, and only written once it has found its place
+  template <bool Upper>
+  auto rolling::sift(size_t i) -> void {
+      auto& h = half<Upper>();
+      auto above = [](int a, int b) { return Upper ? a < b : a > b; };
+      auto slot = h[i];
+      auto v = ring_[slot];
+
+      auto start = i;
+      while (i > 0 && above(v, value(h, (i - 1) / 2))) {
+          place<Upper>(i, h[(i - 1) / 2]);
+          i = (i - 1) / 2;
+      }
+      if (i == start) {
+          for (auto child = 2 * i + 1; child < h.size(); child = 2 * i + 1) {
+              if (child + 1 < h.size() && above(value(h, child + 1), value(h, child))) ++child;
+              if (!above(value(h, child), v)) break;
+              place<Upper>(i, h[child]);
+              i = child;
+          }
+      }
+      place<Upper>(i, slot);
+  }
+
+  template <bool Upper>
+  auto rolling::push_heap(uint32_t slot) -> void {
+      auto& h = half<Upper>();
+      h.push_back(slot);
+      place<Upper>(h.size() - 1, slot);
+      sift<Upper>(h.size() - 1);
+  }
+
+  template <bool Upper>
+  auto rolling::pop_heap() -> uint32_t {
+      auto& h = half<Upper>();
+      auto slot = h[0];
+      place<Upper>(0, h.back());
+      h.pop_back();
+      if (!h.empty()) sift<Upper>(0);
+      return slot;
+  }
+
+  auto rolling::insert(uint32_t slot) -> void {
+      if (lower_.empty() || ring_[slot] <= value(lower_, 0)) {
+          push_heap<false>(slot);
+      } else {
+          push_heap<true>(slot);
+      }
+
+      if (lower_.size() > upper_.size() + 1) {
+          push_heap<true>(pop_heap<false>());
+      } else if (upper_.size() > lower_.size()) {
+          push_heap<false>(pop_heap<true>());
+      }
+  }
+
+  // the slot's value was replaced in place: restore its own heap, and if
+  // it crossed the middle, trade the two tops (one trade is enough, as
+  // only this value moved)
+  auto rolling::update(uint32_t slot) -> void {
+      auto i = where_[slot] & ~upper_bit;
+      if (where_[slot] & upper_bit) {
+          sift<true>(i);
+      } else {
+          sift<false>(i);
+      }
+
+      if (!upper_.empty() && value(lower_, 0) > value(upper_, 0)) {
+          auto low = lower_[0], high = upper_[0];
+          place<false>(0, high);
+          place<true>(0, low);
+          sift<false>(0);
+          sift<true>(0);
+      }
+  }
+
+  auto rolling::resync() -> void {
+      auto mean = static_cast<double>(sum_) / count_;
+      double m2 = 0.0;
+      for (auto v : ring_) {
+          auto d = v - mean;
+          m2 += d * d;
+      }
+      m2_ = m2;
+  }
+}
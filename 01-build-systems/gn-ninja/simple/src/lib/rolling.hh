@@ -0,0 +1,121 @@
+#ifndef SIMPLE_STATS_ROLLING_H
+#define SIMPLE_STATS_ROLLING_H
+
+#include "simple-stats.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ss {
+  /// per-sample results of rolling::push(span, outputs); out.x[i] is taken
+  /// once data[i] is in the window. spans left empty are not written, the
+  /// others must be at least as long as data
+  struct rolling_outputs {
+    std::span<std::int64_t> sum = {};
+    std::span<double> mean = {};
+    std::span<double> variance = {};
+    std::span<int> min = {};
+    std::span<int> max = {};
+    std::span<double> median = {};
+  };
+
+  /// statistics of the last window samples of a stream, updated as each
+  /// sample arrives instead of recomputed over every window
+  ///
+  /// sum, mean and variance cost O(1) per sample; min and max come from
+  /// monotonic queues, amortized O(1); the median from two heaps of the
+  /// window's slots (lower half max-first, upper half min-first) in
+  /// O(log window). all storage is sized by the constructor, so pushing
+  /// never allocates, and clear() keeps it for the next stream
+  ///
+  /// until the window fills, statistics are over the samples seen so far;
+  /// an empty window reports NaN for the floating point statistics and 0
+  /// for min and max. variance is the population variance, as elsewhere
+  class STATS_API rolling {
+  public:
+    /// what to maintain; a statistic that is not tracked costs nothing
+    /// per sample and reads as 0 (or NaN) rather than its value
+    enum track : unsigned {
+      sums = 1,      // sum, mean, variance
+      extremes = 2,  // min, max
+      medians = 4,   // median
+      all = sums | extremes | medians,
+    };
+
+    /// window is the number of samples covered, at least 1
+    explicit rolling(std::size_t window, unsigned tracked = all);
+
+    /// slide the window one sample forward
+    auto push(int value) -> void;
+
+    /// slide the window over data, recording the requested statistics
+    /// after every sample
+    auto push(std::span<const int> data, const rolling_outputs& out) -> void;
+
+    /// empty the window, keeping its storage
+    auto clear() -> void;
+
+    auto window() const -> std::size_t { return window_; }
+    auto size() const -> std::size_t { return count_; }
+
+    auto sum() const -> std::int64_t { return sum_; }
+    auto mean() const -> double;
+    auto variance() const -> double;
+    auto min() const -> int;
+    auto max() const -> int;
+    auto median() const -> double;
+
+  private:
+    struct entry {
+        std::uint64_t seq;
+        int value;
+    };
+
+    // a deque of at most window entries on a fixed ring
+    struct queue {
+        std::vector<entry> items;
+        std::size_t front = 0;
+        std::size_t size = 0;
+    };
+
+    // slots of ring_ in heap order; where_[slot] is the slot's index in
+    // its heap, with the top bit set for the upper half
+    using heap = std::vector<std::uint32_t>;
+
+    template <typename Before>
+    auto slide(queue& q, std::uint64_t seq, int value, Before before) -> void;
+
+    auto wrap(std::size_t i) const -> std::size_t { return i < window_ ? i : i - window_; }
+    auto value(const heap& h, std::size_t i) const -> int { return ring_[h[i]]; }
+    template <bool Upper> auto half() -> heap& { return Upper ? upper_ : lower_; }
+    template <bool Upper> auto place(std::size_t i, std::uint32_t slot) -> void;
+    template <bool Upper> auto sift(std::size_t i) -> void;
+    template <bool Upper> auto push_heap(std::uint32_t slot) -> void;
+    template <bool Upper> auto pop_heap() -> std::uint32_t;
+    auto insert(std::uint32_t slot) -> void;
+    auto update(std::uint32_t slot) -> void;
+    auto resync() -> void;
+
+    std::size_t window_;
+    unsigned tracked_;
+    double inverse_;  // 1 / window_
+    std::vector<int> ring_;
+    std::uint32_t next_ = 0;  // slot of ring_ the next sample goes to
+    std::uint64_t seq_ = 0;
+    std::size_t count_ = 0;
+
+    std::int64_t sum_ = 0;
+    double m2_ = 0.0;
+
+    queue lows_;
+    queue highs_;
+
+    heap lower_;
+    heap upper_;
+    std::vector<std::uint32_t> where_;
+  };
+}
+
+#endif /* SIMPLE_STATS_ROLLING_H */
@@ -0,0 +1,71 @@
+#ifndef SIMPLE_STATS_RUNNING_STATS_H
+#define SIMPLE_STATS_RUNNING_STATS_H
+
+#include "simple-stats.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace ss {
+  namespace detail { struct stats_wire; }
+
+  /// constant-memory accumulator for data that arrives over time;
+  /// samples are folded in as they come and a summary can be taken at
+  /// any point in O(1), without ever materializing the stream
+  ///
+  /// accumulators are independent values, so each thread or shard can
+  /// own one and combine them afterwards with merge(); nothing is shared
+  /// and nothing needs a lock
+  class STATS_API running_stats {
+  public:
+    /// fold in one sample (Welford's update)
+    auto push(int value) -> void {
+        ++count_;
+        sum_ += static_cast<std::uint64_t>(value);
+        auto delta = value - mean_;
+        mean_ += delta / static_cast<double>(count_);
+        m2_ += delta * (value - mean_);
+        min_ = value < min_ ? value : min_;
+        max_ = value > max_ ? value : max_;
+    }
+
+    /// fold in a batch; cheaper per sample than repeated push(int), as
+    /// the batch is reduced in cache-sized blocks that are then merged
+    auto push(std::span<const int> values) -> void;
+
+    /// combine another accumulator into this one, as if every sample
+    /// pushed into other had been pushed here (Chan et al.)
+    auto merge(const running_stats& other) -> void;
+
+    auto count() const -> std::size_t { return count_; }
+    /// total of every sample, wrapping modulo 2^64 like ss::sum
+    auto sum() const -> std::int64_t { return static_cast<std::int64_t>(sum_); }
+
+    /// same fields and conventions as ss::summarize
+    auto snapshot() const -> summary;
+
+    /// the exact accumulator state in a fixed little-endian layout, so a
+    /// restarted process can resume where this one stopped
+    auto serialize() const -> std::vector<std::byte>;
+
+    /// inverse of serialize(); nullopt when bytes are truncated, from
+    /// another format version, or internally inconsistent
+    static auto deserialize(std::span<const std::byte> bytes) -> std::optional<running_stats>;
+
+  private:
+    friend struct detail::stats_wire;
+
+    std::size_t count_ = 0;
+    std::uint64_t sum_ = 0;  // sum_accumulator<int>: wraps where int64_t overflow is undefined
+    double mean_ = 0.0;
+    double m2_ = 0.0;
+    int min_ = std::numeric_limits<int>::max();
+    int max_ = std::numeric_limits<int>::min();
+  };
+}
+
+#endif /* SIMPLE_STATS_RUNNING_STATS_H */
@@ -0,0 +1,101 @@
+#ifndef SIMPLE_STATS_SELECT_H
+#define SIMPLE_STATS_SELECT_H
+
+// internal to the ss library: the pieces of quantile selection shared by
+// the serial and the parallel engines
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace ss::detail {
+  struct bucket_base {
+    std::size_t offset;  // where the bucket starts in select_arena::items
+    std::size_t first;   // global rank of the bucket's smallest element
+  };
+
+  /// scratch for one selection; vectors keep their capacity between
+  /// calls, so steady-state calls do not allocate
+  struct select_arena {
+    std::vector<int> items;
+    std::vector<std::size_t> counts;
+    std::vector<std::size_t> cursors;
+    std::vector<bucket_base> bases;
+    std::vector<std::size_t> ranks;
+    std::vector<int> values;
+  };
+
+  /// the calling thread's arena
+  auto thread_arena() -> select_arena&;
+
+  /// maps ints in [lo, hi] to at most 2^16 buckets in value order, sized
+  /// so that n elements land about 16 to a bucket
+  struct radix_buckets {
+    radix_buckets(int lo, int hi, std::size_t n);
+
+    auto operator()(int v) const -> std::size_t {
+        return static_cast<std::size_t>((key(v) - base) >> shift);
+    }
+
+    static auto key(int v) -> std::uint32_t {
+        return static_cast<std::uint32_t>(v) ^ 0x8000'0000u;
+    }
+
+    std::uint32_t base;
+    int shift;
+    std::size_t size;
+  };
+
+  /// the distinct, sorted order statistics (0-based ranks) that the
+  /// quantiles qs of n elements interpolate between
+  auto collect_ranks(std::size_t n, std::span<const double> qs,
+                     std::vector<std::size_t>& ranks) -> void;
+
+  /// selects each of the sorted, distinct ranks within items in turn;
+  /// after placing rank r only the tail past r needs looking at
+  template <typename T>
+  auto multi_select(std::span<T> items, std::span<const std::size_t> ranks,
+                    std::span<T> values) -> void {
+      auto first = items.begin();
+      for (std::size_t i = 0; i < ranks.size(); ++i) {
+          auto nth = items.begin() + ranks[i];
+          std::nth_element(first, nth, items.end());
+          values[i] = *nth;
+          first = nth + 1;
+      }
+  }
+
+  /// takes the bucket histogram in a.counts and turns it into a map from
+  /// bucket to 1 + its slot among the buckets holding a requested rank (0
+  /// when not needed); a.cursors[slot] is where the slot starts in items.
+  /// returns the number of elements the needed buckets hold in total
+  auto plan_gather(select_arena& a) -> std::size_t;
+
+  /// once items holds the needed buckets, resolves every rank in values
+  auto select_gathered(select_arena& a) -> void;
+
+  /// linear interpolation between the order statistics values[i] of
+  /// rank ranks[i], as selected for qs by collect_ranks
+  template <typename T>
+  auto interpolate(std::size_t n, std::span<const double> qs, std::span<const std::size_t> ranks,
+                   std::span<const T> values, std::span<double> out) -> void {
+      auto value_at = [&](std::size_t r) -> double {
+          return static_cast<double>(values[std::ranges::lower_bound(ranks, r) - ranks.begin()]);
+      };
+      for (std::size_t i = 0; i < qs.size(); ++i) {
+          if (std::isnan(qs[i])) {
+              out[i] = std::numeric_limits<double>::quiet_NaN();
+              continue;
+          }
+          auto h = (n - 1) * std::clamp(qs[i], 0.0, 1.0);
+          auto r = static_cast<std::size_t>(h);
+          auto x = value_at(r);
+          out[i] = (r + 1 < n && h > r) ? x + (h - r) * (value_at(r + 1) - x) : x;
+      }
+  }
+}
+
+#endif /* SIMPLE_STATS_SELECT_H */
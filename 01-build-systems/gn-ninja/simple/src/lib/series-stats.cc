@@ -0,0 +1,118 @@
+#include "series-stats.hh"
+#include "kernels.hh"
+#include "parallel-stats.hh"
+#include "thread-pool.hh"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace ss {
+  using namespace std;
+
+  namespace {
+    // series shorter than this are summed by a plain loop; setting up
+    // the vector kernel would cost more than the adds
+    constexpr size_t short_sum = 64;
+
+    // medians of series up to this long are taken by insertion sort in a
+    // stack buffer, up to small_median by nth_element over a per-thread
+    // copy, and beyond that by ss::quantiles
+    constexpr size_t tiny_median = 32;
+    constexpr size_t small_median = 4096;
+
+    // when balancing batches, each series is charged this many elements'
+    // worth of work on top of its own elements
+    constexpr size_t series_cost = 16;
+
+    // aim for this many batches per thread, to leave something to steal
+    constexpr size_t batches_per_thread = 8;
+
+    auto series_sum(span<const int> s) -> int64_t {
+        if (s.size() >= short_sum) return detail::sum_i32(s.data(), s.size());
+        int64_t total = 0;
+        for (auto v : s) total += v;
+        return total;
+    }
+
+    auto series_median(span<const int> s) -> double {
+        auto n = s.size();
+        if (n == 0) return numeric_limits<double>::quiet_NaN();
+
+        if (n <= tiny_median) {
+            int sorted[tiny_median];
+            for (size_t i = 0; i < n; ++i) {
+                auto v = s[i];
+                auto j = i;
+                for (; j > 0 && sorted[j - 1] > v; --j) sorted[j] = sorted[j - 1];
+                sorted[j] = v;
+            }
+            return n % 2 ? sorted[n / 2] : (static_cast<double>(sorted[n / 2 - 1]) + sorted[n / 2]) / 2;
+        }
+
+        if (n <= small_median) {
+            thread_local vector<int> scratch;
+            scratch.assign(s.begin(), s.end());
+            auto mid = scratch.begin() + n / 2;
+            nth_element(scratch.begin(), mid, scratch.end());
+            if (n % 2) return *mid;
+            return (static_cast<double>(*max_element(scratch.begin(), mid)) + *mid) / 2;
+        }
+
+        constexpr double half = 0.5;
+        double result;
+        quantiles(s, span(&half, 1), span(&result, 1));
+        return result;
+    }
+
+    auto summarize_range(span<const int> values, span<const size_t> offsets, size_t first,
+                         size_t last, const series_outputs& out) -> void {
+        for (auto i = first; i < last; ++i) {
+            auto s = values.subspan(offsets[i], offsets[i + 1] - offsets[i]);
+            if (!out.sum.empty() || !out.mean.empty()) {
+                auto total = series_sum(s);
+                if (!out.sum.empty()) out.sum[i] = total;
+                if (!out.mean.empty()) {
+                    out.mean[i] = s.empty() ? numeric_limits<double>::quiet_NaN()
+                                            : static_cast<double>(total) / s.size();
+                }
+            }
+            if (!out.median.empty()) out.median[i] = series_median(s);
+        }
+    }
+  }
+
+  auto summarize_series(span<const int> values, span<const size_t> offsets,
+                        const series_outputs& out) -> void {
+      auto count = offsets.empty() ? 0 : offsets.size() - 1;
+      auto threads = values.size() < parallel::serial_threshold() ? 1 : parallel::max_threads();
+      if (threads == 1 || count < 2) {
+          summarize_range(values, offsets, 0, count, out);
+          return;
+      }
+
+      // batch b is series [bounds[b], bounds[b + 1]), cut where the
+      // running cost crosses b / batches of the total
+      auto cost = [&](size_t i) { return offsets[i] - offsets[0] + series_cost * i; };
+      auto batches = min(count, threads * batches_per_thread);
+      vector<size_t> bounds(batches + 1, count);
+      bounds[0] = 0;
+      for (size_t b = 1; b < batches; ++b) {
+          auto target = cost(count) / batches * b;
+          size_t lo = bounds[b - 1], hi = count;
+          while (lo < hi) {
+              auto mid = lo + (hi - lo) / 2;
+              if (cost(mid) < target) {
+                  lo = mid + 1;
+              } else {
+                  hi = mid;
+              }
+          }
+          bounds[b] = lo;
+      }
+
+      detail::thread_pool::instance().run(batches, threads, [&](size_t b, size_t) {
+          summarize_range(values, offsets, bounds[b], bounds[b + 1], out);
+      });
+  }
+}
@@ -0,0 +1,253 @@
+#include "snapshot.hh"
+#include "wire.hh"
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ss {
+  using namespace std;
+
+  namespace {
+    constexpr uint8_t format_version = 1;
+    constexpr char format_magic[4] = {'s', 's', 's', 'n'};
+    constexpr size_t header_bytes = 16;
+
+    template <typename State> constexpr state_kind kind_of = state_kind::running_stats;
+    template <> constexpr state_kind kind_of<quantile_sketch> = state_kind::quantile_sketch;
+    template <> constexpr state_kind kind_of<int_group_aggregate> = state_kind::int_groups;
+    template <> constexpr state_kind kind_of<string_group_aggregate> = state_kind::string_groups;
+
+    template <typename State>
+    auto merged(span<const byte> a, span<const byte> b) -> optional<vector<byte>> {
+        auto x = State::deserialize(a);
+        auto y = State::deserialize(b);
+        if (!x || !y) return nullopt;
+        x->merge(*y);
+        return x->serialize();
+    }
+
+    auto merged(state_kind kind, span<const byte> a, span<const byte> b) -> optional<vector<byte>> {
+        switch (kind) {
+          case state_kind::running_stats: return merged<running_stats>(a, b);
+          case state_kind::quantile_sketch: return merged<quantile_sketch>(a, b);
+          case state_kind::int_groups: return merged<int_group_aggregate>(a, b);
+          case state_kind::string_groups: return merged<string_group_aggregate>(a, b);
+        }
+        return nullopt;
+    }
+
+    auto failed(const string& path, const char* what) -> unexpected<string> {
+        return unexpected(path + ": " + what);
+    }
+  }
+
+  auto snapshot::put(string_view name, const running_stats& state) -> void {
+      entries_.insert_or_assign(string(name), entry{state_kind::running_stats, state.serialize()});
+  }
+
+  auto snapshot::put(string_view name, const quantile_sketch& state) -> void {
+      entries_.insert_or_assign(string(name), entry{state_kind::quantile_sketch, state.serialize()});
+  }
+
+  auto snapshot::put(string_view name, const int_group_aggregate& state) -> void {
+      entries_.insert_or_assign(string(name), entry{state_kind::int_groups, state.serialize()});
+  }
+
+  auto snapshot::put(string_view name, const string_group_aggregate& state) -> void {
+      entries_.insert_or_assign(string(name), entry{state_kind::string_groups, state.serialize()});
+  }
+
+  template <typename State>
+  auto snapshot::get(string_view name) const -> optional<State> {
+      auto* e = find(name, kind_of<State>);
+      if (!e) return nullopt;
+      return State::deserialize(e->bytes);
+  }
+
+  auto snapshot::kind(string_view name) const -> optional<state_kind> {
+      auto it = entries_.find(name);
+      if (it == entries_.end()) return nullopt;
+      return it->second.kind;
+  }
+
+  auto snapshot::names() const -> vector<string_view> {
+      vector<string_view> out;
+      out.reserve(entries_.size());
+      for (auto& [name, e] : entries_) out.push_back(name);
+      return out;
+  }
+
+  auto snapshot::erase(string_view name) -> bool {
+      auto it = entries_.find(name);
+      if (it == entries_.end()) return false;
+      entries_.erase(it);
+      return true;
+  }
+
+  auto snapshot::find(string_view name, state_kind kind) const -> const entry* {
+      auto it = entries_.find(name);
+      if (it == entries_.end() || it->second.kind != kind) return nullptr;
+      return &it->second;
+  }
+
+  auto snapshot::merge(const snapshot& other) -> expected<void, string> {
+      // every merged state is worked out before any is stored, so a
+      // failure part way leaves nothing half merged
+      vector<pair<string_view, vector<byte>>> updates;
+      for (auto& [name, theirs] : other.entries_) {
+          auto it = entries_.find(name);
+          if (it == entries_.end()) continue;
+          if (it->second.kind != theirs.kind) {
+              return unexpected(name + ": held as different kinds of state");
+          }
+          auto bytes = merged(theirs.kind, it->second.bytes, theirs.bytes);
+          if (!bytes) return unexpected(name + ": state does not decode");
+          updates.emplace_back(name, std::move(*bytes));
+      }
+
+      for (auto& [name, bytes] : updates) entries_.find(name)->second.bytes = std::move(bytes);
+      for (auto& [name, theirs] : other.entries_) {
+          if (!entries_.contains(name)) entries_.emplace(name, theirs);
+      }
+      return {};
+  }
+
+  // layout: magic[4] version:u8 reserved[3] entries:u64, then for each
+  // entry kind:u8 reserved[3] name_length:u32 size:u64, its name and its
+  // size bytes of serialized state, in name order
+  auto snapshot::serialize() const -> vector<byte> {
+      size_t total = header_bytes;
+      for (auto& [name, e] : entries_) total += 16 + name.size() + e.bytes.size();
+
+      vector<byte> out;
+      out.reserve(total);
+      for (auto c : format_magic) out.push_back(static_cast<byte>(c));
+      detail::put(out, format_version);
+      for (size_t i = 0; i < 3; ++i) detail::put(out, uint8_t{0});
+      detail::put(out, static_cast<uint64_t>(entries_.size()));
+      for (auto& [name, e] : entries_) {
+          detail::put(out, static_cast<uint8_t>(e.kind));
+          for (size_t i = 0; i < 3; ++i) detail::put(out, uint8_t{0});
+          detail::put(out, static_cast<uint32_t>(name.size()));
+          detail::put(out, static_cast<uint64_t>(e.bytes.size()));
+          detail::put_bytes(out, as_bytes(span(name.data(), name.size())));
+          detail::put_bytes(out, e.bytes);
+      }
+      return out;
+  }
+
+  auto snapshot::deserialize(span<const byte> in) -> optional<snapshot> {
+      if (in.size() < header_bytes) return nullopt;
+      for (size_t i = 0; i < sizeof(format_magic); ++i) {
+          if (in[i] != static_cast<byte>(format_magic[i])) return nullopt;
+      }
+      in = in.subspan(sizeof(format_magic));
+
+      uint8_t version = 0, reserved[3];
+      uint64_t count = 0;
+      if (!detail::get(in, version) || version != format_version) return nullopt;
+      for (auto& r : reserved) detail::get(in, r);
+      if (!detail::get(in, count)) return nullopt;
+
+      snapshot result;
+      for (uint64_t i = 0; i < count; ++i) {
+          uint8_t kind = 0;
+          uint32_t name_length = 0;
+          uint64_t size = 0;
+          if (!detail::get(in, kind)) return nullopt;
+          for (auto& r : reserved) detail::get(in, r);
+          if (!detail::get(in, name_length) || !detail::get(in, size)) return nullopt;
+          if (kind < 1 || kind > 4) return nullopt;
+          auto name = detail::get_bytes(in, name_length);
+          auto bytes = name ? detail::get_bytes(in, size) : nullopt;
+          if (!bytes) return nullopt;
+
+          string key(reinterpret_cast<const char*>(name->data()), name->size());
+          entry e{static_cast<state_kind>(kind), vector<byte>(bytes->begin(), bytes->end())};
+          if (!result.entries_.emplace(std::move(key), std::move(e)).second) return nullopt;
+      }
+      if (!in.empty()) return nullopt;
+      return result;
+  }
+
+  auto snapshot::save(const string& path) const -> expected<void, string> {
+      auto bytes = serialize();
+      auto temp = path + ".tmp";
+      auto fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+      if (fd < 0) return failed(temp, strerror(errno));
+
+      for (size_t done = 0; done < bytes.size();) {
+          auto n = ::write(fd, bytes.data() + done, bytes.size() - done);
+          if (n < 0 && errno == EINTR) continue;
+          if (n < 0) {
+              auto err = errno;
+              ::close(fd);
+              ::unlink(temp.c_str());
+              return failed(temp, strerror(err));
+          }
+          done += static_cast<size_t>(n);
+      }
+      if (::fsync(fd) != 0 || ::close(fd) != 0) {
+          auto err = errno;
+          ::unlink(temp.c_str());
+          return failed(temp, strerror(err));
+      }
+      if (::rename(temp.c_str(), path.c_str()) != 0) {
+          auto err = errno;
+          ::unlink(temp.c_str());
+          return failed(path, strerror(err));
+      }
+
+      // the rename is an entry in the directory, and a crash can lose it
+      // until the directory itself is synced
+      auto slash = path.rfind('/');
+      auto dir = slash == string::npos ? string(".") : slash == 0 ? string("/") : path.substr(0, slash);
+      auto dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      if (dir_fd < 0) return failed(dir, strerror(errno));
+      if (::fsync(dir_fd) != 0) {
+          auto err = errno;
+          ::close(dir_fd);
+          return failed(dir, strerror(err));
+      }
+      ::close(dir_fd);
+      return {};
+  }
+
+  auto snapshot::load(const string& path) -> expected<snapshot, string> {
+      auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) return failed(path, strerror(errno));
+      struct stat st;
+      if (fstat(fd, &st) != 0) {
+          auto err = errno;
+          ::close(fd);
+          return failed(path, strerror(err));
+      }
+      auto length = static_cast<size_t>(st.st_size);
+      if (length < header_bytes) {
+          ::close(fd);
+          return failed(path, "too short for a snapshot");
+      }
+
+      auto map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      auto err = errno;
+      ::close(fd);  // the mapping keeps the file open
+      if (map == MAP_FAILED) return failed(path, strerror(err));
+      madvise(map, length, MADV_SEQUENTIAL);
+
+      auto result = deserialize({static_cast<const byte*>(map), length});
+      munmap(map, length);
+      if (!result) return failed(path, "not a snapshot, or a corrupt one");
+      return std::move(*result);
+  }
+
+  template auto snapshot::get<running_stats>(string_view) const -> optional<running_stats>;
+  template auto snapshot::get<quantile_sketch>(string_view) const -> optional<quantile_sketch>;
+  template auto snapshot::get<int_group_aggregate>(string_view) const -> optional<int_group_aggregate>;
+  template auto snapshot::get<string_group_aggregate>(string_view) const -> optional<string_group_aggregate>;
+}
@@ -0,0 +1,224 @@
+// the templated entry points of simple-stats.hh; definitions live here,
+// not in the header, and are instantiated below for every sample type
+#include "simple-stats.hh"
+#include "kernels.hh"
+#include "probe.hh"
+#include "running-stats.hh"
+#include "select.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace ss {
+  using namespace std;
+
+  namespace {
+    // see running-stats.cc; same blocking, same reasons
+    constexpr size_t block_size = 2048;
+
+    // the most items quantiles_of keeps allocated per thread between
+    // calls (64 KiB of double); a larger copy is freed before returning
+    // rather than held for the thread's lifetime
+    constexpr size_t kept_items = 8192;
+
+    struct moments {
+        size_t n = 0;
+        double mean = 0.0;
+        double m2 = 0.0;
+    };
+
+    auto merge(const moments& a, const moments& b) -> moments {
+        if (a.n == 0) return b;
+        auto n = a.n + b.n;
+        auto delta = b.mean - a.mean;
+        auto mean = a.mean + delta * static_cast<double>(b.n) / n;
+        auto m2 = a.m2 + b.m2 + delta * delta * (static_cast<double>(a.n) * b.n / n);
+        return {n, mean, m2};
+    }
+
+    // View is span<const T> or strided_span<T>: both index and size alike
+
+    template <sample T, typename View>
+    auto sum_range(const View& data, size_t first, size_t last) -> sum_type<T> {
+        // independent partial sums: for floating point they let the adds
+        // overlap, for integers they are what the vectorizer wants anyway
+        using acc_type = sum_accumulator<T>;
+        acc_type acc[4] = {};
+        auto i = first;
+        for (; i + 4 <= last; i += 4) {
+            for (size_t j = 0; j < 4; ++j) acc[j] += static_cast<acc_type>(data[i + j]);
+        }
+        for (; i < last; ++i) acc[0] += static_cast<acc_type>(data[i]);
+        return static_cast<sum_type<T>>((acc[0] + acc[1]) + (acc[2] + acc[3]));
+    }
+
+    template <sample T, typename View>
+    auto sum_of(const View& data) -> sum_type<T> {
+        if constexpr (is_same_v<T, int> && is_same_v<View, span<const int>>) {
+            return detail::sum_i32(data.data(), data.size());
+        } else {
+            return sum_range<T>(data, 0, data.size());
+        }
+    }
+
+    template <sample T, typename View>
+    auto summarize_of(const View& data) -> basic_summary<T> {
+        basic_summary<T> s;
+        s.count = data.size();
+        if (s.count == 0) {
+            s.mean = s.variance = s.stddev = numeric_limits<double>::quiet_NaN();
+            return s;
+        }
+
+        if constexpr (is_same_v<T, int> && is_same_v<View, span<const int>>) {
+            running_stats stats;
+            stats.push(data);
+            return stats.snapshot();
+        } else {
+            T lo = data[0], hi = data[0];
+            sum_accumulator<T> sum = 0;
+            moments total;
+            for (size_t begin = 0; begin < s.count; begin += block_size) {
+                auto end = min(s.count, begin + block_size);
+                for (auto i = begin; i < end; ++i) {
+                    lo = min(lo, data[i]);
+                    hi = max(hi, data[i]);
+                }
+                auto block_sum = sum_range<T>(data, begin, end);
+                sum += static_cast<sum_accumulator<T>>(block_sum);
+
+                auto n = end - begin;
+                auto mean = static_cast<double>(block_sum) / n;
+                double m2 = 0.0;
+                for (auto i = begin; i < end; ++i) {
+                    auto d = static_cast<double>(data[i]) - mean;
+                    m2 += d * d;
+                }
+                total = merge(total, {n, mean, m2});
+            }
+
+            s.sum = static_cast<sum_type<T>>(sum);
+            s.mean = static_cast<double>(s.sum) / s.count;
+            s.min = lo;
+            s.max = hi;
+            s.variance = total.m2 / s.count;
+            s.stddev = sqrt(s.variance);
+            return s;
+        }
+    }
+
+    template <sample T, typename View>
+    auto quantiles_of(const View& data, span<const double> qs, span<double> out) -> void {
+        if constexpr (is_same_v<T, int> && is_same_v<View, span<const int>>) {
+            ss::quantiles(data, qs, out);  // the radix engine
+        } else {
+            auto n = data.size();
+            if (n == 0) {
+                fill_n(out.begin(), qs.size(), numeric_limits<double>::quiet_NaN());
+                return;
+            }
+
+            // per type and thread, reused across calls
+            thread_local vector<T> items, values;
+            thread_local vector<size_t> ranks;
+            items.resize(n);
+            for (size_t i = 0; i < n; ++i) items[i] = data[i];
+            detail::collect_ranks(n, qs, ranks);
+            values.resize(ranks.size());
+            detail::multi_select<T>(items, ranks, values);
+            detail::interpolate<T>(n, qs, ranks, values, out);
+            if (items.capacity() > kept_items) vector<T>().swap(items);
+        }
+    }
+  }
+
+  template <sample T> auto sum(span<const T> data) -> sum_type<T> {
+      SS_PROBE(sum, data.size());
+      return sum_of<T>(data);
+  }
+
+  template <sample T> auto sum(strided_span<T> data) -> sum_type<T> {
+      SS_PROBE(sum, data.size());
+      return data.contiguous() ? sum_of<T>(data.as_span()) : sum_of<T>(data);
+  }
+
+  template <sample T> auto average(span<const T> data) -> double {
+      SS_PROBE(average, data.size());
+      return static_cast<double>(sum(data)) / data.size();
+  }
+
+  template <sample T> auto average(strided_span<T> data) -> double {
+      SS_PROBE(average, data.size());
+      return static_cast<double>(sum(data)) / data.size();
+  }
+
+  template <sample T> auto summarize(span<const T> data) -> basic_summary<T> {
+      SS_PROBE(summarize, data.size());
+      return summarize_of<T>(data);
+  }
+
+  template <sample T> auto summarize(strided_span<T> data) -> basic_summary<T> {
+      SS_PROBE(summarize, data.size());
+      return data.contiguous() ? summarize_of<T>(data.as_span()) : summarize_of<T>(data);
+  }
+
+  template <sample T> auto quantiles(span<const T> data, span<const double> qs, span<double> out) -> void {
+      SS_PROBE(quantiles, data.size());
+      quantiles_of<T>(data, qs, out);
+  }
+
+  template <sample T> auto quantiles(strided_span<T> data, span<const double> qs, span<double> out) -> void {
+      SS_PROBE(quantiles, data.size());
+      if (data.contiguous()) {
+          quantiles_of<T>(data.as_span(), qs, out);
+      } else {
+          quantiles_of<T>(data, qs, out);
+      }
+  }
+
+  template <sample T> auto median(span<const T> data) -> double {
+      SS_PROBE(median, data.size());
+      constexpr double half = 0.5;
+      double result;
+      quantiles(data, span(&half, 1), span(&result, 1));
+      return result;
+  }
+
+  template <sample T> auto median(strided_span<T> data) -> double {
+      SS_PROBE(median, data.size());
+      constexpr double half = 0.5;
+      double result;
+      quantiles(data, span(&half, 1), span(&result, 1));
+      return result;
+  }
+
+#define SS_INSTANTIATE(T)                                                                      \
+  template auto sum<T>(span<const T>) -> sum_type<T>;                                          \
+  template auto sum<T>(strided_span<T>) -> sum_type<T>;                                        \
+  template auto average<T>(span<const T>) -> double;                                           \
+  template auto average<T>(strided_span<T>) -> double;                                         \
+  template auto summarize<T>(span<const T>) -> basic_summary<T>;                               \
+  template auto summarize<T>(strided_span<T>) -> basic_summary<T>;                             \
+  template auto median<T>(span<const T>) -> double;                                            \
+  template auto median<T>(strided_span<T>) -> double;                                          \
+  template auto quantiles<T>(span<const T>, span<const double>, span<double>) -> void;         \
+  template auto quantiles<T>(strided_span<T>, span<const double>, span<double>) -> void;
+
+  SS_INSTANTIATE(signed char)
+  SS_INSTANTIATE(unsigned char)
+  SS_INSTANTIATE(short)
+  SS_INSTANTIATE(unsigned short)
+  SS_INSTANTIATE(int)
+  SS_INSTANTIATE(unsigned int)
+  SS_INSTANTIATE(long)
+  SS_INSTANTIATE(unsigned long)
+  SS_INSTANTIATE(long long)
+  SS_INSTANTIATE(unsigned long long)
+  SS_INSTANTIATE(float)
+  SS_INSTANTIATE(double)
+
+#undef SS_INSTANTIATE
+}
@@ -0,0 +1,116 @@
+#ifndef SIMPLE_STATS_WIRE_H
+#define SIMPLE_STATS_WIRE_H
+
+// internal to the ss library: the little-endian encoding shared by the
+// serialized forms of accumulators, sketches and snapshots
+#include "quantile-sketch.hh"
+#include "running-stats.hh"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace ss::detail {
+  // scalars and arrays are copied as they are on little-endian hosts, and
+  // assembled a byte at a time elsewhere
+
+  template <typename T>
+  auto put(std::vector<std::byte>& out, T value) -> void {
+      if constexpr (std::is_floating_point_v<T>) {
+          put(out, std::bit_cast<std::uint64_t>(static_cast<double>(value)));
+      } else {
+          auto bits = static_cast<std::make_unsigned_t<T>>(value);
+          if constexpr (std::endian::native == std::endian::little) {
+              auto at = out.size();
+              out.resize(at + sizeof(T));
+              std::memcpy(out.data() + at, &bits, sizeof(T));
+          } else {
+              for (std::size_t i = 0; i < sizeof(T); ++i) {
+                  out.push_back(static_cast<std::byte>(bits >> (8 * i)));
+              }
+          }
+      }
+  }
+
+  template <typename T>
+  auto get(std::span<const std::byte>& in, T& value) -> bool {
+      if constexpr (std::is_floating_point_v<T>) {
+          std::uint64_t bits = 0;
+          if (!get(in, bits)) return false;
+          value = static_cast<T>(std::bit_cast<double>(bits));
+          return true;
+      } else {
+          if (in.size() < sizeof(T)) return false;
+          std::make_unsigned_t<T> bits = 0;
+          if constexpr (std::endian::native == std::endian::little) {
+              std::memcpy(&bits, in.data(), sizeof(T));
+          } else {
+              for (std::size_t i = 0; i < sizeof(T); ++i) {
+                  bits |= static_cast<std::make_unsigned_t<T>>(std::to_integer<std::uint8_t>(in[i])) << (8 * i);
+              }
+          }
+          value = static_cast<T>(bits);
+          in = in.subspan(sizeof(T));
+          return true;
+      }
+  }
+
+  template <typename T>
+  auto put_array(std::vector<std::byte>& out, std::span<const T> values) -> void {
+      static_assert(std::is_integral_v<T>);
+      if constexpr (std::endian::native == std::endian::little) {
+          auto at = out.size();
+          out.resize(at + values.size_bytes());
+          if (!values.empty()) std::memcpy(out.data() + at, values.data(), values.size_bytes());
+      } else {
+          for (auto v : values) put(out, v);
+      }
+  }
+
+  template <typename T>
+  auto get_array(std::span<const std::byte>& in, std::span<T> values) -> bool {
+      static_assert(std::is_integral_v<T>);
+      if (in.size() < values.size_bytes()) return false;
+      if constexpr (std::endian::native == std::endian::little) {
+          if (!values.empty()) std::memcpy(values.data(), in.data(), values.size_bytes());
+          in = in.subspan(values.size_bytes());
+      } else {
+          for (auto& v : values) get(in, v);
+      }
+      return true;
+  }
+
+  inline auto put_bytes(std::vector<std::byte>& out, std::span<const std::byte> bytes) -> void {
+      out.insert(out.end(), bytes.begin(), bytes.end());
+  }
+
+  /// the next n bytes of in, viewed in place
+  inline auto get_bytes(std::span<const std::byte>& in, std::size_t n)
+      -> std::optional<std::span<const std::byte>> {
+      if (in.size() < n) return std::nullopt;
+      auto bytes = in.first(n);
+      in = in.subspan(n);
+      return bytes;
+  }
+
+  // the bodies of the serialized forms, without magic or version, so
+  // containers can embed many of them back to back; get consumes exactly
+  // what put wrote
+
+  struct stats_wire {
+      static auto put(std::vector<std::byte>& out, const running_stats& s) -> void;
+      static auto get(std::span<const std::byte>& in) -> std::optional<running_stats>;
+  };
+
+  struct sketch_wire {
+      static auto put(std::vector<std::byte>& out, const quantile_sketch& s) -> void;
+      static auto get(std::span<const std::byte>& in) -> std::optional<quantile_sketch>;
+  };
+}
+
+#endif /* SIMPLE_STATS_WIRE_H */
@@ -0,0 +1,227 @@
+#ifndef STATS_SERVER_PROTOCOL_H
+#define STATS_SERVER_PROTOCOL_H
+
+// messages between stats-server and its clients, one per frame (see
+// framing.hh); integers and doubles are little-endian
+//
+//   samples   1, u8 name length, name, then int32 samples to the end
+//   query     2, u32 id, u8 what, u8 name length, name, then for what =
+//             quantiles the ranks in [0, 1] as f64 to the end
+//   reply     3, u32 id, u8 status, u64 count, i64 sum, then f64 values
+//             to the end: none for sum, the mean, the median, or one per
+//             queried rank
+//
+// a client may send any number of samples and queries without waiting;
+// replies come back in the order the queries were sent
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "buffer-pool.hh"
+#include "framing.hh"
+
+namespace protocol {
+    enum class type : std::uint8_t { samples = 1, query, reply };
+    enum class what : std::uint8_t { sum = 1, mean, median, quantiles };
+    enum class status : std::uint8_t { ok = 0, unknown_stream, bad_request };
+
+    constexpr std::size_t max_name = 255;
+    constexpr std::size_t max_ranks = 64;
+
+    // samples, still in the frame they arrived in
+    struct samples {
+        std::string_view name;
+        std::span<const char> values; // int32 each
+
+        std::size_t count() const { return values.size() / 4; }
+
+        // out holds count() ints
+        void copy_to(int *out) const {
+            if constexpr (std::endian::native == std::endian::little) {
+                std::memcpy(out, values.data(), values.size());
+            } else {
+                for (std::size_t i = 0; i < count(); ++i) {
+                    std::uint32_t v = 0;
+                    for (std::size_t b = 0; b < 4; ++b) v |= std::uint32_t(std::uint8_t(values[4 * i + b])) << (8 * b);
+                    out[i] = static_cast<int>(v);
+                }
+            }
+        }
+    };
+
+    struct query {
+        std::uint32_t id = 0;
+        protocol::what what = what::sum;
+        std::string_view name;
+        std::vector<double> ranks;
+    };
+
+    struct reply {
+        std::uint32_t id = 0;
+        protocol::status status = status::ok;
+        std::uint64_t count = 0;
+        std::int64_t sum = 0;
+        std::vector<double> values;
+    };
+
+    namespace detail {
+        // cursor over a payload; reads past the end leave it failed
+        struct reader {
+            std::span<const char> rest;
+            bool ok = true;
+
+            template <typename T> T get() {
+                if (rest.size() < sizeof(T)) {
+                    ok = false;
+                    return T{};
+                }
+                std::uint64_t v = 0;
+                for (std::size_t b = 0; b < sizeof(T); ++b) v |= std::uint64_t(std::uint8_t(rest[b])) << (8 * b);
+                rest = rest.subspan(sizeof(T));
+                if constexpr (sizeof(T) == 8 && std::is_floating_point_v<T>) {
+                    return std::bit_cast<T>(v);
+                } else {
+                    return static_cast<T>(v);
+                }
+            }
+
+            std::string_view name() {
+                auto n = get<std::uint8_t>();
+                if (!ok || rest.size() < n) {
+                    ok = false;
+                    return {};
+                }
+                auto out = std::string_view(rest.data(), n);
+                rest = rest.subspan(n);
+                return out;
+            }
+
+            std::optional<std::vector<double>> doubles(std::size_t limit) {
+                if (rest.size() % 8 != 0 || rest.size() / 8 > limit) return std::nullopt;
+                std::vector<double> out(rest.size() / 8);
+                for (auto &d : out) d = get<double>();
+                return out;
+            }
+        };
+
+        struct writer {
+            char *at;
+
+            template <typename T> void put(T value) {
+                std::uint64_t v;
+                if constexpr (std::is_floating_point_v<T>) {
+                    v = std::bit_cast<std::uint64_t>(value);
+                } else {
+                    v = static_cast<std::uint64_t>(value);
+                }
+                for (std::size_t b = 0; b < sizeof(T); ++b) *at++ = static_cast<char>(v >> (8 * b));
+            }
+
+            void name(std::string_view s) {
+                put(static_cast<std::uint8_t>(s.size()));
+                at = std::copy(s.begin(), s.end(), at);
+            }
+        };
+
+        // a pooled buffer with the frame header for payload bytes written,
+        // and a writer positioned after it
+        inline std::pair<framing::frame, writer> start(buffer_pool &pool, std::size_t payload) {
+            auto buffer = pool.acquire(framing::max_header + payload);
+            auto n = framing::put_header(static_cast<std::uint32_t>(payload), buffer.data());
+            auto w = writer{buffer.data() + n};
+            return {framing::frame{std::move(buffer), n + payload}, w};
+        }
+    } // namespace detail
+
+    inline std::optional<type> type_of(std::span<const char> payload) {
+        if (payload.empty()) return std::nullopt;
+        auto t = static_cast<std::uint8_t>(payload[0]);
+        if (t < 1 || t > 3) return std::nullopt;
+        return static_cast<type>(t);
+    }
+
+    inline std::optional<samples> parse_samples(std::span<const char> payload) {
+        detail::reader r{payload.subspan(1)};
+        auto name = r.name();
+        if (!r.ok || r.rest.size() % 4 != 0) return std::nullopt;
+        return samples{name, r.rest};
+    }
+
+    inline std::optional<query> parse_query(std::span<const char> payload) {
+        detail::reader r{payload.subspan(1)};
+        query q;
+        q.id = r.get<std::uint32_t>();
+        auto w = r.get<std::uint8_t>();
+        q.name = r.name();
+        if (!r.ok || w < 1 || w > 4) return std::nullopt;
+        q.what = static_cast<what>(w);
+        if (q.what == what::quantiles) {
+            auto ranks = r.doubles(max_ranks);
+            if (!ranks) return std::nullopt;
+            q.ranks = std::move(*ranks);
+        } else if (!r.rest.empty()) {
+            return std::nullopt;
+        }
+        return q;
+    }
+
+    inline std::optional<reply> parse_reply(std::span<const char> payload) {
+        detail::reader r{payload.subspan(1)};
+        reply out;
+        out.id = r.get<std::uint32_t>();
+        out.status = static_cast<status>(r.get<std::uint8_t>());
+        out.count = r.get<std::uint64_t>();
+        out.sum = r.get<std::int64_t>();
+        if (!r.ok) return std::nullopt;
+        auto values = r.doubles(max_ranks);
+        if (!values) return std::nullopt;
+        out.values = std::move(*values);
+        return out;
+    }
+
+    // name is at most max_name bytes
+    inline framing::frame encode_samples(buffer_pool &pool, std::string_view name, std::span<const int> values) {
+        auto [frame, w] = detail::start(pool, 2 + name.size() + 4 * values.size());
+        w.put(static_cast<std::uint8_t>(type::samples));
+        w.name(name);
+        if constexpr (std::endian::native == std::endian::little) {
+            std::memcpy(w.at, values.data(), values.size_bytes());
+        } else {
+            for (auto v : values) w.put(static_cast<std::uint32_t>(v));
+        }
+        return std::move(frame);
+    }
+
+    // ranks only for what::quantiles, at most max_ranks of them
+    inline framing::frame encode_query(buffer_pool &pool, std::uint32_t id, what what, std::string_view name,
+                                       std::span<const double> ranks = {}) {
+        auto [frame, w] = detail::start(pool, 7 + name.size() + 8 * ranks.size());
+        w.put(static_cast<std::uint8_t>(type::query));
+        w.put(id);
+        w.put(static_cast<std::uint8_t>(what));
+        w.name(name);
+        for (auto r : ranks) w.put(r);
+        return std::move(frame);
+    }
+
+    inline framing::frame encode_reply(buffer_pool &pool, const reply &r) {
+        auto [frame, w] = detail::start(pool, 22 + 8 * r.values.size());
+        w.put(static_cast<std::uint8_t>(type::reply));
+        w.put(r.id);
+        w.put(static_cast<std::uint8_t>(r.status));
+        w.put(r.count);
+        w.put(r.sum);
+        for (auto v : r.values) w.put(v);
+        return std::move(frame);
+    }
+} // namespace protocol
+
+#endif /* STATS_SERVER_PROTOCOL_H */
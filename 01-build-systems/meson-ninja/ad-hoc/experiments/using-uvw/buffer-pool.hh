@@ -0,0 +1,155 @@
+#ifndef USING_UVW_BUFFER_POOL_H
+#define USING_UVW_BUFFER_POOL_H
+
+// I/O buffers for one loop, recycled instead of allocated per read and
+// per write. buffers come in fixed size classes (256 B, 1 KiB, 4 KiB,
+// 16 KiB, 64 KiB); each class keeps a free list, refilled a slab at a
+// time when it runs dry, so the allocator is only visited while the pool
+// grows to the loop's peak. larger requests go to the heap as before
+//
+// a pool belongs to one loop and is only touched from that loop's
+// thread, so nothing here is locked or atomic
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class buffer_pool;
+
+// a buffer on loan from a pool, returned to it when destroyed
+class pooled_buffer {
+public:
+    pooled_buffer() = default;
+
+    pooled_buffer(pooled_buffer &&other) noexcept
+        : pool_(std::exchange(other.pool_, nullptr)),
+          data_(std::exchange(other.data_, nullptr)),
+          capacity_(std::exchange(other.capacity_, 0)),
+          size_class_(other.size_class_) {}
+
+    pooled_buffer &operator=(pooled_buffer &&other) noexcept {
+        if (this != &other) {
+            reset();
+            pool_ = std::exchange(other.pool_, nullptr);
+            data_ = std::exchange(other.data_, nullptr);
+            capacity_ = std::exchange(other.capacity_, 0);
+            size_class_ = other.size_class_;
+        }
+        return *this;
+    }
+
+    ~pooled_buffer() { reset(); }
+
+    char *data() const { return data_; }
+    std::size_t capacity() const { return capacity_; }
+    explicit operator bool() const { return data_ != nullptr; }
+
+    // hand the buffer back early
+    inline void reset();
+
+private:
+    friend class buffer_pool;
+
+    pooled_buffer(buffer_pool *pool, char *data, std::size_t capacity, int size_class)
+        : pool_(pool), data_(data), capacity_(capacity), size_class_(size_class) {}
+
+    buffer_pool *pool_ = nullptr;
+    char *data_ = nullptr;
+    std::size_t capacity_ = 0;
+    int size_class_ = -1; // -1: from the heap, not from a class
+};
+
+class buffer_pool {
+public:
+    static constexpr std::size_t class_count = 5;
+    static constexpr std::size_t smallest_class = 256;
+
+    struct counters {
+        std::uint64_t hits = 0;        // served from a free list
+        std::uint64_t misses = 0;      // free list empty, a slab was carved
+        std::uint64_t oversize = 0;    // larger than any class, from the heap
+        std::uint64_t outstanding = 0; // on loan right now
+        std::size_t slab_bytes = 0;    // held by the pool in total
+    };
+
+    // slab_bytes is how much a miss carves into buffers of its class
+    // (at least one)
+    explicit buffer_pool(std::size_t slab_bytes = std::size_t{256} << 10) : slab_bytes_(slab_bytes) {}
+
+    buffer_pool(const buffer_pool &) = delete;
+    buffer_pool &operator=(const buffer_pool &) = delete;
+
+    static constexpr std::size_t class_capacity(int size_class) {
+        return smallest_class << (2 * size_class);
+    }
+
+    // the smallest class that holds size bytes, or -1 when none does
+    static constexpr int class_for(std::size_t size) {
+        for (int c = 0; c < static_cast<int>(class_count); ++c) {
+            if (class_capacity(c) >= size) return c;
+        }
+        return -1;
+    }
+
+    // a buffer of at least size bytes
+    pooled_buffer acquire(std::size_t size) {
+        ++stats_.outstanding;
+        auto c = class_for(size);
+        if (c < 0) {
+            ++stats_.oversize;
+            return {this, new char[size], size, -1};
+        }
+
+        auto &free = free_[c];
+        if (free.empty()) {
+            ++stats_.misses;
+            carve(c);
+        } else {
+            ++stats_.hits;
+        }
+        auto *data = free.back();
+        free.pop_back();
+        return {this, data, class_capacity(c), c};
+    }
+
+    const counters &stats() const { return stats_; }
+
+private:
+    friend class pooled_buffer;
+
+    void carve(int c) {
+        auto capacity = class_capacity(c);
+        auto count = std::max<std::size_t>(1, slab_bytes_ / capacity);
+        slabs_.push_back(std::make_unique_for_overwrite<char[]>(count * capacity));
+        stats_.slab_bytes += count * capacity;
+        auto *base = slabs_.back().get();
+        // handed out from the front of the slab first
+        for (auto i = count; i-- > 0;) free_[c].push_back(base + i * capacity);
+    }
+
+    void give_back(char *data, int size_class) {
+        --stats_.outstanding;
+        if (size_class < 0) {
+            delete[] data;
+        } else {
+            free_[size_class].push_back(data);
+        }
+    }
+
+    std::size_t slab_bytes_;
+    std::array<std::vector<char *>, class_count> free_;
+    std::vector<std::unique_ptr<char[]>> slabs_;
+    counters stats_;
+};
+
+inline void pooled_buffer::reset() {
+    if (data_) pool_->give_back(data_, size_class_);
+    pool_ = nullptr;
+    data_ = nullptr;
+    capacity_ = 0;
+}
+
+#endif /* USING_UVW_BUFFER_POOL_H */
@@ -0,0 +1,84 @@
+#ifndef USING_UVW_HISTOGRAM_H
+#define USING_UVW_HISTOGRAM_H
+
+// latency histogram in the manner of HdrHistogram: exact below 256, then
+// 128 buckets per power of two, so any recorded value is reported within
+// 1/128 (< 0.8%) of itself, from nanoseconds up to 2^40 ns (~18 minutes)
+// in a fixed 35 KiB of counters. recording is a bit_width and an
+// increment; histograms from several threads merge by adding counters
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+class latency_histogram {
+public:
+    static constexpr int sub_bits = 8;
+    static constexpr int max_bits = 40; // larger values land in the last bucket
+    static constexpr std::size_t exact = std::size_t{1} << sub_bits;
+    static constexpr std::size_t half = exact / 2;
+    static constexpr std::size_t bucket_count = exact + (max_bits - sub_bits) * half;
+
+    void record(std::uint64_t value) {
+        ++counts_[index(value)];
+        ++count_;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const latency_histogram &other) {
+        for (std::size_t i = 0; i < bucket_count; ++i) counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    std::uint64_t count() const { return count_; }
+    std::uint64_t min() const { return count_ == 0 ? 0 : min_; }
+    std::uint64_t max() const { return max_; }
+    double mean() const { return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_); }
+
+    // the value at rank q in [0, 1]: the highest value of the bucket that
+    // holds it, so never below the true quantile; 0 when empty
+    std::uint64_t quantile(double q) const {
+        if (count_ == 0) return 0;
+        auto rank = static_cast<std::uint64_t>(q * static_cast<double>(count_ - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < bucket_count; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(highest(i), max_);
+        }
+        return max_;
+    }
+
+    // exposed so the bucketing can be checked
+    static std::size_t index(std::uint64_t value) {
+        if (value < exact) return static_cast<std::size_t>(value);
+        auto top = std::bit_width(value) - 1;
+        if (top >= max_bits) return bucket_count - 1;
+        auto shift = static_cast<int>(top) - sub_bits + 1;
+        auto mantissa = static_cast<std::size_t>(value >> shift); // in [half, exact)
+        return exact + static_cast<std::size_t>(shift - 1) * half + (mantissa - half);
+    }
+
+    static std::uint64_t highest(std::size_t i) {
+        if (i < exact) return i;
+        if (i == bucket_count - 1) return std::numeric_limits<std::uint64_t>::max();
+        auto shift = static_cast<int>((i - exact) / half) + 1;
+        auto mantissa = half + (i - exact) % half;
+        return ((static_cast<std::uint64_t>(mantissa) + 1) << shift) - 1;
+    }
+
+private:
+    std::array<std::uint64_t, bucket_count> counts_{};
+    std::uint64_t count_ = 0;
+    std::uint64_t sum_ = 0;
+    std::uint64_t min_ = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t max_ = 0;
+};
+
+#endif /* USING_UVW_HISTOGRAM_H */
@@ -0,0 +1,240 @@
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <print> // C++23
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <uvw.hpp>
+
+#include "buffer-pool.hh"
+#include "connection.hh"
+#include "histogram.hh"
+
+// loadgen [key=value ...]
+//
+// drives an echo server (main serve) from several loops, each with its
+// share of the connections, and reports throughput and latency
+// percentiles. keys, with their defaults:
+//
+//   host=127.0.0.1 port=4242   the server
+//   connections=1000           spread over the loops
+//   threads=4                  loops, one per thread
+//   size=64                    bytes per message
+//   rate=0                     messages per second over all connections;
+//                              0 is closed loop: each connection sends its
+//                              next message as soon as the last is echoed
+//   seconds=10                 how long to send for
+//
+// latency runs from when a message was due to when its echo completed.
+// with a fixed rate that is the schedule, not the moment the loop got to
+// send it, so a stalled server shows up as latency rather than as
+// messages quietly not sent (coordinated omission)
+
+using namespace std;
+
+namespace {
+    struct options {
+        string host = "127.0.0.1";
+        size_t port = 4242;
+        size_t connections = 1000;
+        size_t threads = 4;
+        size_t size = 64;
+        size_t rate = 0;
+        size_t seconds = 10;
+    };
+
+    uint64_t now_ns() {
+        return static_cast<uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // what one loop measured
+    struct result {
+        latency_histogram latency;
+        uint64_t connected = 0;
+        uint64_t failed = 0;
+        uint64_t messages = 0;
+    };
+
+    struct client {
+        connection *conn = nullptr;
+        deque<uint64_t> due;    // when each message in flight was due
+        size_t echoed = 0;      // bytes of the oldest one back so far
+        uint64_t next_due = 0;  // open loop only
+    };
+
+    class worker {
+    public:
+        worker(const options &o, size_t connections, uint64_t deadline, result &out)
+            : options_(o), count_(connections), deadline_(deadline), out_(out),
+              loop_(uvw::loop::create()), pool_(), batcher_(*loop_), clients_(connections) {
+            // per connection, with the message rate split evenly
+            if (o.rate > 0) interval_ = 1'000'000'000ull * o.connections / o.rate;
+        }
+
+        void run() {
+            auto start = now_ns();
+            mt19937_64 rng(start);
+            for (size_t i = 0; i < count_; ++i) {
+                // spread the first sends over one interval, not all at once
+                clients_[i].next_due = start + (interval_ > 0 ? rng() % interval_ : 0);
+                connect(i);
+            }
+
+            ticker_ = loop_->resource<uvw::timer_handle>();
+            ticker_->on<uvw::timer_event>([this](const uvw::timer_event &, uvw::timer_handle &) { tick(); });
+            ticker_->start(uvw::timer_handle::time{1}, uvw::timer_handle::time{1});
+
+            loop_->run();
+            loop_->close();
+        }
+
+    private:
+        void connect(size_t i) {
+            auto tcp = loop_->resource<uvw::tcp_handle>();
+            tcp->on<uvw::error_event>([this](const uvw::error_event &, uvw::tcp_handle &handle) {
+                ++out_.failed;
+                handle.close();
+            });
+            tcp->on<uvw::connect_event>([this, i](const uvw::connect_event &, uvw::tcp_handle &handle) {
+                ++out_.connected;
+                handle.no_delay(true);
+                auto &conn = connection::attach(handle, pool_, batcher_);
+                clients_[i].conn = &conn;
+                conn.on_data([this, i](connection &, pooled_buffer, size_t length) { echoed(i, length); });
+                conn.on_close([this, i](connection &) { clients_[i].conn = nullptr; });
+                conn.read();
+                if (interval_ == 0) send(clients_[i], now_ns());
+            });
+            tcp->connect(options_.host, static_cast<unsigned int>(options_.port));
+        }
+
+        void send(client &c, uint64_t due) {
+            auto buffer = pool_.acquire(options_.size);
+            fill_n(buffer.data(), options_.size, 'x');
+            c.due.push_back(due);
+            c.conn->write(std::move(buffer), options_.size);
+        }
+
+        void echoed(size_t i, size_t length) {
+            auto &c = clients_[i];
+            c.echoed += length;
+            while (c.echoed >= options_.size && !c.due.empty()) {
+                c.echoed -= options_.size;
+                auto now = now_ns();
+                out_.latency.record(now - c.due.front());
+                ++out_.messages;
+                c.due.pop_front();
+                if (interval_ == 0 && now < deadline_) send(c, now);
+            }
+        }
+
+        // open loop: every message that has come due since the last tick
+        void tick() {
+            auto now = now_ns();
+            if (now >= deadline_) {
+                finish();
+                return;
+            }
+            if (interval_ == 0) return;
+            for (auto &c : clients_) {
+                if (!c.conn) continue;
+                for (; c.next_due <= now; c.next_due += interval_) send(c, c.next_due);
+            }
+        }
+
+        void finish() {
+            loop_->walk([](auto &h) {
+                if (!h.closing()) h.close();
+            });
+        }
+
+        const options &options_;
+        size_t count_;
+        uint64_t deadline_;
+        result &out_;
+        shared_ptr<uvw::loop> loop_;
+        buffer_pool pool_;
+        write_batcher batcher_;
+        vector<client> clients_;
+        shared_ptr<uvw::timer_handle> ticker_;
+        uint64_t interval_ = 0; // ns between a connection's messages, 0 for closed loop
+    };
+
+    bool parse_count(string_view arg, size_t &out) {
+        auto [end, err] = from_chars(arg.data(), arg.data() + arg.size(), out);
+        return err == errc() && end == arg.data() + arg.size();
+    }
+
+    bool parse(int argc, char **argv, options &o) {
+        for (int i = 1; i < argc; ++i) {
+            auto arg = string_view(argv[i]);
+            auto eq = arg.find('=');
+            if (eq == string_view::npos) return false;
+            auto key = arg.substr(0, eq);
+            auto value = arg.substr(eq + 1);
+            if (key == "host") {
+                o.host = string(value);
+                continue;
+            }
+            size_t *field = key == "port"          ? &o.port
+                            : key == "connections" ? &o.connections
+                            : key == "threads"     ? &o.threads
+                            : key == "size"        ? &o.size
+                            : key == "rate"        ? &o.rate
+                            : key == "seconds"     ? &o.seconds
+                                                   : nullptr;
+            if (!field || !parse_count(value, *field)) return false;
+        }
+        return o.port <= 65535 && o.connections > 0 && o.threads > 0 && o.size > 0;
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    options o;
+    if (!parse(argc, argv, o)) {
+        println(stderr, "usage: {} [host=ip] [port=n] [connections=n] [threads=n] [size=bytes] [rate=msg/s] "
+                        "[seconds=n]",
+                argv[0]);
+        return 2;
+    }
+    o.threads = min(o.threads, o.connections);
+
+    println("{} connections over {} loops to {}:{}, {} byte messages, {}, {} s", o.connections, o.threads, o.host,
+            o.port, o.size, o.rate == 0 ? "closed loop"s : to_string(o.rate) + " msg/s", o.seconds);
+
+    auto start = now_ns();
+    auto deadline = start + o.seconds * 1'000'000'000ull;
+    vector<result> results(o.threads);
+    vector<thread> threads;
+    for (size_t t = 0; t < o.threads; ++t) {
+        auto share = o.connections / o.threads + (t < o.connections % o.threads ? 1 : 0);
+        threads.emplace_back([&o, &results, t, share, deadline] { worker(o, share, deadline, results[t]).run(); });
+    }
+    for (auto &t : threads) t.join();
+    auto elapsed = static_cast<double>(now_ns() - start) / 1e9;
+
+    result all;
+    for (auto &r : results) {
+        all.latency.merge(r.latency);
+        all.connected += r.connected;
+        all.failed += r.failed;
+        all.messages += r.messages;
+    }
+    auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1e3; };
+    println("connected {}, failed {}", all.connected, all.failed);
+    println("{} messages in {:.2f} s: {:.0f} msg/s, {:.1f} MB/s each way", all.messages, elapsed,
+            static_cast<double>(all.messages) / elapsed,
+            static_cast<double>(all.messages * o.size) / elapsed / 1e6);
+    println("latency us: mean {:.1f}, p50 {:.1f}, p99 {:.1f}, p99.9 {:.1f}, max {:.1f}", all.latency.mean() / 1e3,
+            us(all.latency.quantile(0.5)), us(all.latency.quantile(0.99)), us(all.latency.quantile(0.999)),
+            us(all.latency.max()));
+    return all.failed == 0 ? 0 : 1;
+}
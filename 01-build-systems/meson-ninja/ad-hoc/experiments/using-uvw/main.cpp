@@ -1,90 +1,285 @@
 
 #include <cassert>
+#include <charconv>
 #include <chrono>
+#include <csignal>
 #include <print> // C++23
+#include <memory>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include <uvw.hpp>
 
+#include "buffer-pool.hh"
+#include "connection.hh"
+#include "framing.hh"
+#include "logger.hh"
+#include "reactor.hh"
+
+// main                   one listener and one client talking on the default loop
+// main serve [threads]   echo server on 127.0.0.1:4242, one loop per thread
+//                        (default: one per hardware thread); ctrl-c stops it,
+//                        SIGUSR1 prints connection counts; idle connections
+//                        are closed after a minute
+// main batching [count]  writes per message with and without write batching,
+//                        over loopback (default: 100000 messages)
+//
+// the listener and client log through an async_logger, so their handlers
+// never wait on stdout; the summaries printed after a loop stops do not
+// need it
+
 using namespace std;
 
-void listen(uvw::loop &loop) {
+void listen(uvw::loop &loop, buffer_pool &pool, write_batcher &batcher, connection_registry &registry,
+            async_logger &log) {
     std::shared_ptr<uvw::tcp_handle> tcp = loop.resource<uvw::tcp_handle>();
     tcp->on<uvw::error_event>([](const uvw::error_event &, uvw::tcp_handle &) { assert(false); });
 
-    tcp->on<uvw::listen_event>([](const uvw::listen_event &, uvw::tcp_handle &srv) {
-        println("listen");
+    tcp->on<uvw::listen_event>([&pool, &batcher, &registry, &log](const uvw::listen_event &, uvw::tcp_handle &srv) {
+        log.log("listen");
 
         std::shared_ptr<uvw::tcp_handle> client = srv.parent().resource<uvw::tcp_handle>();
-        client->on<uvw::error_event>([](const uvw::error_event &, uvw::tcp_handle &) { assert(false); });
-
-        client->on<uvw::close_event>([ptr = srv.shared_from_this()](const uvw::close_event &, uvw::tcp_handle &) {
-            println("close");
-            ptr->close();
-        });
-
         srv.accept(*client);
 
         uvw::socket_address local = srv.sock();
-        println("local: {} {}", local.ip, local.port);
+        log.log("local: {} {}", local.ip, local.port);
 
         uvw::socket_address remote = client->peer();
-        println("remote: {} {}", remote.ip, remote.port);
+        log.log("remote: {} {}", remote.ip, remote.port);
+
+        auto &conn = connection::attach(*client, pool, batcher);
+        conn.track(registry);
+        registry.for_each([&log](connection &c) { log.log("open: {}", c.handle().peer().port); });
 
-        client->on<uvw::data_event>([](const uvw::data_event &event, uvw::tcp_handle &) {
-            // std::cout.write(event.data.get(), static_cast<std::streamsize>(event.length)));
-            print("{}", event.data.get()); //, static_cast<std::streamsize>(event.length)));
-            println("data length: {}", event.length);
+        // the reader outlives each read, to carry a message split across two
+        auto reader = make_shared<frame_reader>([&log](span<const char> message) {
+            log.log("message: {} ({} bytes)", string_view(message.data(), message.size()), message.size());
+        });
+        conn.on_data([reader, &log](connection &c, pooled_buffer buffer, size_t length) {
+            log.log("data length: {}", length);
+            if (!reader->feed({buffer.data(), length})) {
+                log.log("bad frame");
+                c.close();
+            }
         });
 
-        client->on<uvw::end_event>([](const uvw::end_event &, uvw::tcp_handle &handle) {
-            println("end");
-            int count = 0;
-            handle.parent().walk([&count](auto &) { ++count; });
-            println("still alive: {} handles", count);
-            handle.close();
+        // end of stream closes the connection; the registry counts what
+        // is left without walking the loop
+        conn.on_close([&registry, &log, ptr = srv.shared_from_this()](connection &) {
+            log.log("close");
+            log.log("still alive: {} connections", registry.live());
+            ptr->close();
         });
 
-        client->read();
+        conn.read();
     });
 
-    tcp->on<uvw::close_event>([](const uvw::close_event &, uvw::tcp_handle &) {
-        println("close");
+    tcp->on<uvw::close_event>([&log](const uvw::close_event &, uvw::tcp_handle &) {
+        log.log("close");
     });
 
     tcp->bind("127.0.0.1", 4242);
     tcp->listen();
 }
 
-void conn(uvw::loop &loop) {
+// sends the messages "a" and "bc"; both go out together in one vectored write
+void conn(uvw::loop &loop, buffer_pool &pool, write_batcher &batcher, async_logger &log) {
     auto tcp = loop.resource<uvw::tcp_handle>();
     tcp->on<uvw::error_event>([](const uvw::error_event &, uvw::tcp_handle &) { assert(false); });
 
-    tcp->on<uvw::write_event>([](const uvw::write_event &, uvw::tcp_handle &handle) {
-        println("write");
-        handle.close();
+    tcp->on<uvw::connect_event>([&pool, &batcher, &log](const uvw::connect_event &, uvw::tcp_handle &handle) {
+        log.log("connect");
+
+        auto &c = connection::attach(handle, pool, batcher);
+        c.on_close([&batcher, &log](connection &) {
+            log.log("written: {} messages in {} writes", batcher.stats().messages, batcher.stats().writes);
+            log.log("close");
+        });
+        for (auto message : {"a"sv, "bc"sv}) {
+            auto frame = framing::make_frame(pool, message);
+            c.write(std::move(frame.buffer), frame.length);
+        }
+        c.shutdown();
     });
 
-    tcp->on<uvw::connect_event>([](const uvw::connect_event &, uvw::tcp_handle &handle) {
-        println("connect");
+    tcp->connect("127.0.0.1", 4242);
+}
 
-        auto dataTryWrite = std::unique_ptr<char[]>(new char[1]{'a'});
-        int bw = handle.try_write(std::move(dataTryWrite), 1);
-        println("written: ", static_cast<int>(bw));
+// writes small messages to a reader on the same loop, a burst of them per
+// loop iteration, once with every message written on its own and once
+// batched, and counts the writes (about one syscall each) it took
+int batching(size_t messages) {
+    constexpr size_t burst = 64;
+    constexpr string_view message = "0123456789abcdef0123456789abcdef";
 
-        auto dataWrite = std::unique_ptr<char[]>(new char[2]{'b', 'c'});
-        handle.write(std::move(dataWrite), 2);
-    });
+    for (auto [label, options] : {pair{"unbatched", write_options{.max_buffers = 1}}, pair{"batched", write_options{}}}) {
+        auto loop = uvw::loop::create();
+        buffer_pool pool;
+        write_batcher sender(*loop, options);
+        write_batcher receiver(*loop);
+        size_t received = 0;
 
-    tcp->on<uvw::close_event>([](const uvw::close_event &, uvw::tcp_handle &) {
-        println("close");
-    });
+        auto server = loop->resource<uvw::tcp_handle>();
+        server->on<uvw::listen_event>([&](const uvw::listen_event &, uvw::tcp_handle &srv) {
+            auto client = srv.parent().resource<uvw::tcp_handle>();
+            srv.accept(*client);
+            auto &c = connection::attach(*client, pool, receiver);
+            c.on_data([&received](connection &, pooled_buffer, size_t length) { received += length; });
+            c.on_close([&server](connection &) { server->close(); });
+            c.read();
+        });
+        if (server->bind("127.0.0.1", 0) != 0 || server->listen() != 0) {
+            println(stderr, "batching: cannot listen on 127.0.0.1");
+            return 1;
+        }
 
-    tcp->connect("127.0.0.1", 4242);
+        size_t sent = 0;
+        auto pump = loop->resource<uvw::idle_handle>();
+        auto client = loop->resource<uvw::tcp_handle>();
+        client->on<uvw::connect_event>([&](const uvw::connect_event &, uvw::tcp_handle &handle) {
+            auto &c = connection::attach(handle, pool, sender);
+            pump->on<uvw::idle_event>([&c, &sent, messages, message](const uvw::idle_event &, uvw::idle_handle &idle) {
+                for (size_t i = 0; i < burst && sent < messages; ++i, ++sent) c.write(message);
+                if (sent == messages) {
+                    idle.close();
+                    c.shutdown();
+                }
+            });
+            pump->start();
+        });
+        client->connect("127.0.0.1", server->sock().port);
+
+        auto start = chrono::steady_clock::now();
+        loop->run();
+        auto ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        auto &s = sender.stats();
+        println("{:>9}: {} messages in {} writes, {:.3f} writes per message, {} of {} bytes received, {:.1f} ms",
+                label, s.messages, s.writes, static_cast<double>(s.writes) / static_cast<double>(s.messages), received,
+                messages * message.size(), ms);
+
+        // the batchers' check handles are still open
+        loop->walk([](auto &h) {
+            if (!h.closing()) h.close();
+        });
+        loop->run();
+        loop->close();
+    }
+    return 0;
 }
 
-int main() {
+// echoes every connection back to itself on the loop that accepted it,
+// until SIGINT or SIGTERM reaches the main thread. each loop reads into
+// and writes from its own buffer_pool, and echoes the very buffer it read.
+// a connection idle for a minute, or whose peer has taken none of its
+// echo for half of one, is closed
+int serve(size_t threads) {
+    constexpr timeout_options timeouts{.idle = 60s, .write = 30s};
+
+    // per loop, each used only by its own thread; the registries' counts
+    // may be read from any
+    auto loops = threads == 0 ? max(1u, thread::hardware_concurrency()) : threads;
+    vector<unique_ptr<buffer_pool>> buffers(loops);
+    vector<unique_ptr<write_batcher>> batchers(loops);
+    vector<unique_ptr<connection_registry>> registries(loops);
+    vector<unique_ptr<loop_timers>> timers(loops);
+    for (size_t i = 0; i < loops; ++i) {
+        buffers[i] = make_unique<buffer_pool>();
+        registries[i] = make_unique<connection_registry>();
+    }
+
+    reactor_pool pool(
+        {.threads = loops},
+        [&](uvw::tcp_handle &client, size_t worker) {
+            client.no_delay(true);
+            auto &conn = connection::attach(client, *buffers[worker], *batchers[worker]);
+            conn.track(*registries[worker]);
+            conn.expire_after(*timers[worker], timeouts);
+            conn.on_data([](connection &c, pooled_buffer buffer, size_t length) { c.write(std::move(buffer), length); });
+            conn.read();
+        },
+        [&batchers, &timers](uvw::loop &loop, size_t worker) {
+            batchers[worker] = make_unique<write_batcher>(loop);
+            timers[worker] = make_unique<loop_timers>(loop);
+        });
+    if (!pool.start()) return 1;
+    println("serving on 127.0.0.1:{} with {} loops", pool.port(), pool.threads());
+
+    auto print_connections = [&registries] {
+        for (size_t i = 0; i < registries.size(); ++i) {
+            auto c = registries[i]->read();
+            println("loop {}: {} live, {} accepted, {} closed, {} on error, {} timed out", i, c.live, c.accepted,
+                    c.closed, c.errored, c.timed_out);
+        }
+    };
+
+    // the main thread only waits for signals: SIGUSR1 prints the
+    // connection counts, read without disturbing the loops; SIGINT and
+    // SIGTERM hand shutdown over to the loops through their async handles
     auto loop = uvw::loop::get_default();
-    listen(*loop);
-    conn(*loop);
+    auto report = loop->resource<uvw::signal_handle>();
+    report->on<uvw::signal_event>([&](const uvw::signal_event &, uvw::signal_handle &) { print_connections(); });
+    report->start(SIGUSR1);
+    for (auto signum : {SIGINT, SIGTERM}) {
+        auto signal = loop->resource<uvw::signal_handle>();
+        signal->on<uvw::signal_event>([&pool](const uvw::signal_event &, uvw::signal_handle &handle) {
+            pool.stop();
+            handle.parent().walk([](auto &h) { h.close(); });
+        });
+        signal->start(signum);
+    }
+    loop->run();
+    pool.join();
+
+    print_connections();
+    for (size_t i = 0; i < loops; ++i) {
+        auto &s = buffers[i]->stats();
+        auto &w = batchers[i]->stats();
+        println("loop {}: buffers: {} hits, {} misses, {} oversize, {} KiB pooled, "
+                "{} writes in {} calls, {} pauses for {} ms, peak {} KiB unsent",
+                i, s.hits, s.misses, s.oversize, s.slab_bytes >> 10, w.messages, w.writes, w.pauses,
+                w.paused_ns / 1'000'000, w.peak_buffered >> 10);
+    }
+    return 0;
+}
+
+// a whole non-negative number, or false
+bool parse_count(string_view arg, size_t &out) {
+    auto [end, err] = from_chars(arg.data(), arg.data() + arg.size(), out);
+    return err == errc() && end == arg.data() + arg.size();
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 2 && string_view(argv[1]) == "serve") {
+        size_t threads = 0;
+        if (argc > 2 && !parse_count(argv[2], threads)) {
+            println(stderr, "usage: {} serve [threads]", argv[0]);
+            return 2;
+        }
+        return serve(threads);
+    }
+    if (argc >= 2 && string_view(argv[1]) == "batching") {
+        size_t messages = 100'000;
+        if (argc > 2 && (!parse_count(argv[2], messages) || messages == 0)) {
+            println(stderr, "usage: {} batching [count]", argv[0]);
+            return 2;
+        }
+        return batching(messages);
+    }
+
+    auto loop = uvw::loop::get_default();
+    buffer_pool pool;
+    write_batcher batcher(*loop);
+    connection_registry registry;
+    async_logger log;
+    listen(*loop, pool, batcher, registry, log);
+    conn(*loop, pool, batcher, log);
+    loop->run();
+    // the batcher's check handle is still open
+    loop->walk([](auto &h) {
+        if (!h.closing()) h.close();
+    });
     loop->run();
     loop = nullptr;
 }
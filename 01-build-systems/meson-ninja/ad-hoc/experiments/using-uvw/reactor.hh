@@ -0,0 +1,174 @@
+#ifndef USING_UVW_REACTOR_H
+#define USING_UVW_REACTOR_H
+
+// N event loops, one per thread, each with its own listener bound to the
+// same address with SO_REUSEPORT, so the kernel spreads incoming
+// connections over the loops and no loop ever touches another's sockets.
+// on Linux the spread is a hash of the connection; BSD and macOS accept
+// the shared bind but do not balance, so one loop may get most of them
+//
+// stop() may be called from any thread: it wakes every loop through its
+// async_handle, and each loop closes its own handles and returns
+#include <uvw.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <print> // C++23
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct reactor_options {
+    std::string ip = "127.0.0.1";
+    unsigned int port = 4242; // 0 picks a free port, shared by every loop
+    std::size_t threads = 0;  // 0 is one per hardware thread
+    int backlog = 1024;
+};
+
+class reactor_pool {
+public:
+    // called on the worker's own thread for every accepted connection
+    using accept_fn = std::function<void(uvw::tcp_handle &client, std::size_t worker)>;
+
+    // called on the starting thread for each loop before any runs, to
+    // hang per-loop state off it (see uvw::loop::data)
+    using setup_fn = std::function<void(uvw::loop &loop, std::size_t worker)>;
+
+    reactor_pool(reactor_options options, accept_fn on_accept, setup_fn on_setup = {})
+        : options_(std::move(options)), on_accept_(std::move(on_accept)), on_setup_(std::move(on_setup)) {
+        if (options_.threads == 0) options_.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    reactor_pool(const reactor_pool &) = delete;
+    reactor_pool &operator=(const reactor_pool &) = delete;
+
+    ~reactor_pool() {
+        stop();
+        join();
+    }
+
+    // binds every listener, then starts the threads; on failure nothing
+    // is left running and the reason has been printed
+    bool start() {
+        for (std::size_t i = 0; i < options_.threads; ++i) {
+            auto w = std::make_unique<worker>();
+            w->loop = uvw::loop::create();
+            if (on_setup_) on_setup_(*w->loop, i);
+            if (!listen(*w, i)) {
+                workers_.push_back(std::move(w));
+                abandon();
+                return false;
+            }
+            workers_.push_back(std::move(w));
+        }
+
+        for (auto &w : workers_) {
+            w->thread = std::thread([loop = w->loop] {
+                loop->run();
+                loop->close();
+            });
+        }
+        return true;
+    }
+
+    // asks every loop to close its handles and return; safe from any
+    // thread, and more than once
+    void stop() {
+        if (stopping_.exchange(true)) return;
+        for (auto &w : workers_) {
+            if (w->thread.joinable()) w->wakeup->send();
+        }
+    }
+
+    void join() {
+        for (auto &w : workers_) {
+            if (w->thread.joinable()) w->thread.join();
+        }
+    }
+
+    std::size_t threads() const { return options_.threads; }
+    unsigned int port() const { return options_.port; }
+
+private:
+    struct worker {
+        std::shared_ptr<uvw::loop> loop;
+        std::shared_ptr<uvw::tcp_handle> listener;
+        std::shared_ptr<uvw::async_handle> wakeup;
+        std::thread thread;
+    };
+
+    bool listen(worker &w, std::size_t index) {
+        auto family = options_.ip.find(':') == std::string::npos ? AF_INET : AF_INET6;
+        auto fd = ::socket(family, SOCK_STREAM, 0);
+        int on = 1;
+        if (fd < 0 || ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on) != 0 ||
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on) != 0) {
+            std::println(stderr, "loop {}: socket: {}", index, std::strerror(errno));
+            if (fd >= 0) ::close(fd);
+            return false;
+        }
+
+        w.listener = w.loop->resource<uvw::tcp_handle>();
+        w.listener->on<uvw::error_event>([index](const uvw::error_event &event, uvw::tcp_handle &) {
+            std::println(stderr, "loop {}: listener: {}", index, event.what());
+        });
+        w.listener->on<uvw::listen_event>([this, index](const uvw::listen_event &, uvw::tcp_handle &srv) {
+            auto client = srv.parent().resource<uvw::tcp_handle>();
+            if (srv.accept(*client) != 0) {
+                client->close();
+                return;
+            }
+            on_accept_(*client, index);
+        });
+
+        // once open, the handle owns fd and closes it with itself
+        auto err = w.listener->open(fd);
+        if (err != 0) ::close(fd);
+        if (err == 0) err = w.listener->bind(options_.ip, options_.port);
+        if (err == 0) err = w.listener->listen(options_.backlog);
+        if (err != 0) {
+            std::println(stderr, "loop {}: listen on {}:{}: {}", index, options_.ip, options_.port, uv_strerror(err));
+            return false;
+        }
+        // with port 0 the first bind picks the port the others must share
+        if (options_.port == 0) options_.port = w.listener->sock().port;
+
+        w.wakeup = w.loop->resource<uvw::async_handle>();
+        w.wakeup->on<uvw::async_event>([](const uvw::async_event &, uvw::async_handle &handle) {
+            handle.parent().walk([](auto &h) {
+                if (!h.closing()) h.close();
+            });
+        });
+        return true;
+    }
+
+    // start() failed part way: close what was opened, on this thread, as
+    // no loop is running yet
+    void abandon() {
+        for (auto &w : workers_) {
+            w->loop->walk([](auto &h) {
+                if (!h.closing()) h.close();
+            });
+            w->loop->run();
+            w->loop->close();
+        }
+        workers_.clear();
+    }
+
+    reactor_options options_;
+    accept_fn on_accept_;
+    setup_fn on_setup_;
+    std::vector<std::unique_ptr<worker>> workers_;
+    std::atomic<bool> stopping_{false};
+};
+
+#endif /* USING_UVW_REACTOR_H */
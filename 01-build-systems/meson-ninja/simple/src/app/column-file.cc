@@ -0,0 +1,176 @@
+#include "column-file.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace app {
+  using namespace std;
+
+  namespace {
+    constexpr char format_magic[4] = {'s', 's', 'c', 'o'};
+    constexpr uint16_t format_version = 1;
+    constexpr size_t header_bytes = 32;
+
+    // without a chunk index, files are walked in windows of this size
+    constexpr uint64_t window_bytes = uint64_t{64} << 20;
+
+    template <typename T>
+    auto load(const byte* at) -> T {
+        T value;
+        memcpy(&value, at, sizeof(T));
+        return value;
+    }
+
+    auto failed(const char* path, const char* what) -> unexpected<string> {
+        return unexpected(string(path) + ": " + what);
+    }
+  }
+
+  auto type_name(column_type type) -> string_view {
+      switch (type) {
+        case column_type::i8: return "i8";
+        case column_type::u8: return "u8";
+        case column_type::i16: return "i16";
+        case column_type::u16: return "u16";
+        case column_type::i32: return "i32";
+        case column_type::u32: return "u32";
+        case column_type::i64: return "i64";
+        case column_type::u64: return "u64";
+        case column_type::f32: return "f32";
+        case column_type::f64: return "f64";
+      }
+      return "unknown";
+  }
+
+  auto type_size(column_type type) -> size_t {
+      switch (type) {
+        case column_type::i8: case column_type::u8: return 1;
+        case column_type::i16: case column_type::u16: return 2;
+        case column_type::i32: case column_type::u32: case column_type::f32: return 4;
+        case column_type::i64: case column_type::u64: case column_type::f64: return 8;
+      }
+      return 0;
+  }
+
+  auto column_file::open(const char* path) -> expected<column_file, string> {
+      // samples are used in place, so they must already be in host order
+      if constexpr (endian::native != endian::little) {
+          return failed(path, "column files are little-endian; this host is not");
+      }
+
+      auto fd = ::open(path, O_RDONLY | O_CLOEXEC);
+      if (fd < 0) return failed(path, strerror(errno));
+      struct stat st;
+      if (fstat(fd, &st) != 0) {
+          auto err = errno;
+          ::close(fd);
+          return failed(path, strerror(err));
+      }
+      if (static_cast<uint64_t>(st.st_size) < header_bytes) {
+          ::close(fd);
+          return failed(path, "too short for a column file header");
+      }
+
+      column_file file;
+      file.length_ = static_cast<size_t>(st.st_size);
+      auto map = mmap(nullptr, file.length_, PROT_READ, MAP_PRIVATE, fd, 0);
+      auto err = errno;
+      ::close(fd);  // the mapping keeps the file open
+      if (map == MAP_FAILED) return failed(path, strerror(err));
+      file.map_ = map;
+      madvise(map, file.length_, MADV_SEQUENTIAL);
+
+      auto base = static_cast<const byte*>(map);
+      if (memcmp(base, format_magic, sizeof format_magic) != 0) {
+          return failed(path, "not a column file");
+      }
+      if (load<uint16_t>(base + 4) != format_version) {
+          return failed(path, "unsupported column file version");
+      }
+      file.type_ = static_cast<column_type>(load<uint8_t>(base + 6));
+      auto size = type_size(file.type_);
+      if (size == 0) return failed(path, "unknown element type");
+
+      file.count_ = load<uint64_t>(base + 8);
+      auto chunks = load<uint64_t>(base + 16);
+      auto offset = load<uint64_t>(base + 24);
+
+      // each check keeps the next one's arithmetic from overflowing
+      auto available = file.length_ - header_bytes;
+      if (chunks > 0 && chunks >= available / sizeof(uint64_t)) {
+          return failed(path, "truncated chunk index");
+      }
+      auto index_end = header_bytes + (chunks == 0 ? 0 : (chunks + 1) * sizeof(uint64_t));
+      if (offset < index_end || offset > file.length_ || offset % size != 0) {
+          return failed(path, "bad data offset");
+      }
+      if (file.count_ > (file.length_ - offset) / size) return failed(path, "truncated data");
+      file.data_ = base + offset;
+
+      if (chunks > 0) {
+          file.bounds_.resize(chunks + 1);
+          memcpy(file.bounds_.data(), base + header_bytes, (chunks + 1) * sizeof(uint64_t));
+          if (file.bounds_.front() != 0 || file.bounds_.back() != file.count_ ||
+              !is_sorted(file.bounds_.begin(), file.bounds_.end())) {
+              return failed(path, "chunk index does not cover the rows in order");
+          }
+      } else {
+          auto window = window_bytes / size;
+          for (uint64_t row = 0; row < file.count_; row += window) file.bounds_.push_back(row);
+          file.bounds_.push_back(file.count_);
+      }
+      return file;
+  }
+
+  column_file::column_file(column_file&& other) noexcept
+      : map_(exchange(other.map_, nullptr)),
+        length_(exchange(other.length_, 0)),
+        data_(exchange(other.data_, nullptr)),
+        type_(other.type_),
+        count_(exchange(other.count_, 0)),
+        bounds_(std::move(other.bounds_)) {}
+
+  auto column_file::operator=(column_file&& other) noexcept -> column_file& {
+      if (this != &other) {
+          if (map_) munmap(map_, length_);
+          map_ = exchange(other.map_, nullptr);
+          length_ = exchange(other.length_, 0);
+          data_ = exchange(other.data_, nullptr);
+          type_ = other.type_;
+          count_ = exchange(other.count_, 0);
+          bounds_ = std::move(other.bounds_);
+      }
+      return *this;
+  }
+
+  column_file::~column_file() {
+      if (map_) munmap(map_, length_);
+  }
+
+  auto column_file::prefetch(uint64_t first, uint64_t last) const -> void {
+      advise(first, last, MADV_WILLNEED, false);
+  }
+
+  auto column_file::release(uint64_t first, uint64_t last) const -> void {
+      // a partial page at either end may still be needed by a neighbour
+      advise(first, last, MADV_DONTNEED, true);
+  }
+
+  auto column_file::advise(uint64_t first, uint64_t last, int advice, bool inner) const -> void {
+      static const auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+      auto size = type_size(type_);
+      auto begin = reinterpret_cast<uintptr_t>(data_ + first * size);
+      auto end = reinterpret_cast<uintptr_t>(data_ + last * size);
+      begin = inner ? (begin + page - 1) & ~(page - 1) : begin & ~(page - 1);
+      end = inner ? end & ~(page - 1) : (end + page - 1) & ~(page - 1);
+      if (begin < end) madvise(reinterpret_cast<void*>(begin), end - begin, advice);
+  }
+}
@@ -0,0 +1,94 @@
+#ifndef SIMPLE_STATS_APP_COLUMN_FILE_H
+#define SIMPLE_STATS_APP_COLUMN_FILE_H
+
+// read-only, memory-mapped access to binary column files, so the app can
+// hand ss spans that point straight into the page cache
+//
+// a column file holds one column of fixed-width samples; all fields are
+// little-endian:
+//
+//   offset  size  field
+//        0     4  magic "ssco"
+//        4     2  version (1)
+//        6     1  element type (column_type)
+//        7     1  reserved, 0
+//        8     8  count, number of samples
+//       16     8  chunks, entries in the chunk index (0 when absent)
+//       24     8  data offset, a multiple of the element size
+//       32   8*n  chunk index when chunks > 0: n = chunks + 1 ascending row
+//                 numbers from 0 to count; chunk i is rows [idx[i], idx[i+1])
+//
+// the samples follow, packed, at the data offset; writers should put it
+// on a page boundary (4096) so chunks start on pages of their own
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace app {
+  enum class column_type : std::uint8_t {
+    i8 = 1, u8, i16, u16, i32, u32, i64, u64, f32, f64,
+  };
+
+  auto type_name(column_type type) -> std::string_view;
+  auto type_size(column_type type) -> std::size_t;
+
+  /// a mapped column file; movable, not copyable, unmapped on destruction
+  ///
+  /// the whole file is mapped once, which only costs address space, and
+  /// the kernel is told the access is sequential. callers walk it chunk
+  /// by chunk, prefetching the next chunk and releasing the last, so the
+  /// resident set stays around two chunks however large the file is
+  class column_file {
+  public:
+    /// maps path and validates its header; the error says what was wrong
+    static auto open(const char* path) -> std::expected<column_file, std::string>;
+
+    column_file(column_file&& other) noexcept;
+    auto operator=(column_file&& other) noexcept -> column_file&;
+    ~column_file();
+
+    auto type() const -> column_type { return type_; }
+    auto count() const -> std::uint64_t { return count_; }
+
+    /// rows [first, last) of chunk i; files without a chunk index are cut
+    /// into page-aligned windows of about 64 MiB
+    auto chunks() const -> std::size_t { return bounds_.size() - 1; }
+    auto chunk(std::size_t i) const -> std::pair<std::uint64_t, std::uint64_t> {
+        return {bounds_[i], bounds_[i + 1]};
+    }
+
+    /// the samples as T, which must match type()
+    template <typename T>
+    auto rows(std::uint64_t first, std::uint64_t last) const -> std::span<const T> {
+        return {reinterpret_cast<const T*>(data_) + first, static_cast<std::size_t>(last - first)};
+    }
+
+    template <typename T>
+    auto all() const -> std::span<const T> { return rows<T>(0, count_); }
+
+    /// asks the kernel to start reading rows [first, last) in
+    auto prefetch(std::uint64_t first, std::uint64_t last) const -> void;
+
+    /// drops the pages wholly inside rows [first, last) from this
+    /// process; they are read back from the file if touched again
+    auto release(std::uint64_t first, std::uint64_t last) const -> void;
+
+  private:
+    column_file() = default;
+    auto advise(std::uint64_t first, std::uint64_t last, int advice, bool inner) const -> void;
+
+    void* map_ = nullptr;
+    std::size_t length_ = 0;
+    const std::byte* data_ = nullptr;
+    column_type type_ = column_type::i32;
+    std::uint64_t count_ = 0;
+    std::vector<std::uint64_t> bounds_;
+  };
+}
+
+#endif /* SIMPLE_STATS_APP_COLUMN_FILE_H */
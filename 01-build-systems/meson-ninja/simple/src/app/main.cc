@@ -1,12 +1,137 @@
+#include "column-file.hh"
+#include "parallel-stats.hh"
 #include "simple-stats.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
 #include <print>  // C++23, not available in g++; use clang++17 or higher
+#include <vector>
+
+#include <unistd.h>
 
-auto main() -> int {
+// app-static                 stats of a small built-in sample
+// app-static <column-file>   stats of a column file (see column-file.hh),
+//                            read in place through a memory mapping
+namespace {
   using namespace std;
   using namespace ss;
 
-  voi nums = {1, 2, 3, 4, 5};
-  println("Sum: {}", sum(nums));
-  println("Average: {:.2f}", average(nums));
-  println("Median: {:.2f}", median(nums));
-}
\ No newline at end of file
+  // folds b into a, as if both had been summarized together (Chan et al.)
+  template <ss::sample T>
+  auto merge(basic_summary<T>& a, const basic_summary<T>& b) -> void {
+    if (b.count == 0) return;
+    if (a.count == 0) {
+      a = b;
+      return;
+    }
+    auto n = a.count + b.count;
+    auto delta = b.mean - a.mean;
+    auto m2 = a.variance * a.count + b.variance * b.count +
+              delta * delta * (static_cast<double>(a.count) * b.count / n);
+    a.count = n;
+    a.sum += b.sum;
+    a.mean = static_cast<double>(a.sum) / n;
+    a.min = min(a.min, b.min);
+    a.max = max(a.max, b.max);
+    a.variance = m2 / n;
+    a.stddev = sqrt(a.variance);
+  }
+
+  template <ss::sample T>
+  auto summarize_chunk(span<const T> rows) -> basic_summary<T> {
+    if constexpr (is_same_v<T, int>) {
+      return parallel::summarize(rows);
+    } else {
+      return summarize(rows);
+    }
+  }
+
+  // an exact median needs the whole column at once: int columns are
+  // selected in place over the mapping, other types through a copy, so
+  // those only when the copy fits comfortably in memory
+  template <ss::sample T>
+  auto column_median(const app::column_file& file) -> optional<double> {
+    if constexpr (is_same_v<T, int>) {
+      return parallel::median(file.all<int>());
+    } else {
+      auto memory = static_cast<uint64_t>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGESIZE);
+      if (file.count() > memory / 2 / sizeof(T)) return nullopt;
+      return median(file.all<T>());
+    }
+  }
+
+  template <ss::sample T>
+  auto report(const app::column_file& file) -> void {
+    // one chunk is summarized while the next is read ahead, and each is
+    // dropped once done with, so files larger than memory stream through
+    auto s = summarize(span<const T>());
+    for (size_t c = 0; c < file.chunks(); ++c) {
+      auto [first, last] = file.chunk(c);
+      if (c + 1 < file.chunks()) {
+        auto [next_first, next_last] = file.chunk(c + 1);
+        file.prefetch(next_first, next_last);
+      }
+      merge(s, summarize_chunk(file.rows<T>(first, last)));
+      file.release(first, last);
+    }
+
+    println("Type: {}", app::type_name(file.type()));
+    println("Count: {}", s.count);
+    println("Sum: {}", s.sum);
+    println("Average: {:.2f}", s.mean);
+    println("Min: {} Max: {}", s.min, s.max);
+    println("Stddev: {:.2f}", s.stddev);
+    if (auto m = column_median<T>(file)) {
+      println("Median: {:.2f}", *m);
+    } else {
+      println("Median: skipped, column larger than half of memory");
+    }
+  }
+
+  auto run_file(const char* path) -> int {
+    auto file = app::column_file::open(path);
+    if (!file) {
+      println(stderr, "{}", file.error());
+      return 1;
+    }
+
+    using app::column_type;
+    switch (file->type()) {
+      case column_type::i8: report<int8_t>(*file); break;
+      case column_type::u8: report<uint8_t>(*file); break;
+      case column_type::i16: report<int16_t>(*file); break;
+      case column_type::u16: report<uint16_t>(*file); break;
+      case column_type::i32: report<int32_t>(*file); break;
+      case column_type::u32: report<uint32_t>(*file); break;
+      case column_type::i64: report<int64_t>(*file); break;
+      case column_type::u64: report<uint64_t>(*file); break;
+      case column_type::f32: report<float>(*file); break;
+      case column_type::f64: report<double>(*file); break;
+    }
+    return 0;
+  }
+
+  auto run_sample() -> void {
+    voi nums = {1, 2, 3, 4, 5};
+    auto s = summarize(nums);
+    println("Count: {}", s.count);
+    println("Sum: {}", s.sum);
+    println("Average: {:.2f}", s.mean);
+    println("Min: {} Max: {}", s.min, s.max);
+    println("Stddev: {:.2f}", s.stddev);
+    println("Median: {:.2f}", median(nums));
+  }
+}
+
+auto main(int argc, char** argv) -> int {
+  using namespace std;
+
+  if (argc > 2) {
+    println(stderr, "usage: {} [column-file]", argv[0]);
+    return 2;
+  }
+  if (argc == 2) return run_file(argv[1]);
+  run_sample();
+}
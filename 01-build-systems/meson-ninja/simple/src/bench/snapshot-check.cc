@@ -0,0 +1,143 @@
+// round trips of ss::snapshot and the states it holds: every kind put,
+// serialized, saved, loaded and read back, shard snapshots merged, and
+// group aggregates merged across different sketch settings; exits with
+// a non-zero status when any state does not come back as it went in
+//
+// usage: snapshot-check [directory]   (default: the system temp directory)
+#include "group-aggregate.hh"
+#include "quantile-sketch.hh"
+#include "running-stats.hh"
+#include "snapshot.hh"
+
+#include <cstdlib>
+#include <filesystem>
+#include <print>  // C++23, not available in g++; use clang++17 or higher
+#include <string>
+#include <string_view>
+
+namespace {
+  using namespace std;
+
+  size_t failures = 0;
+
+  auto check(bool ok, string_view what) -> void {
+    if (ok) return;
+    ++failures;
+    println(stderr, "FAIL: {}", what);
+  }
+
+  // the aggregate, after a trip through its own format and one through a
+  // snapshot file, still has count values under key
+  template <typename Aggregate, typename Key>
+  auto round_trip(const Aggregate& a, Key key, size_t count, bool sketched, const string& path,
+                  string_view what) -> void {
+    auto restored = Aggregate::deserialize(a.serialize());
+    check(restored.has_value(), what);
+    if (!restored) return;
+    auto g = restored->find(key);
+    check(g && g->stats.count() == count, what);
+    check((restored->sketch(0) != nullptr) == sketched, what);
+    if (sketched && restored->sketch(0)) check(restored->sketch(0)->count() == g->stats.count(), what);
+
+    ss::snapshot s;
+    s.put("groups", a);
+    auto saved = s.save(path);
+    check(saved.has_value(), what);
+    auto loaded = ss::snapshot::load(path);
+    check(loaded.has_value(), what);
+    if (loaded) check(loaded->get<Aggregate>("groups").has_value(), what);
+  }
+}
+
+auto main(int argc, char** argv) -> int {
+  auto dir = argc > 1 ? filesystem::path(argv[1]) : filesystem::temp_directory_path();
+  auto path = (dir / "snapshot-check.snap").string();
+
+  // every kind, through serialize and through a file
+  {
+    ss::running_stats stats;
+    ss::quantile_sketch sketch(64);
+    ss::int_group_aggregate ints(32);
+    ss::string_group_aggregate strings;
+    for (int i = 0; i < 10'000; ++i) {
+      stats.push(i);
+      sketch.add(i);
+      ints.add(i % 7, i);
+      strings.add(i % 2 ? "odd" : "even", i);
+    }
+    ss::snapshot s;
+    s.put("stats", stats);
+    s.put("sketch", sketch);
+    s.put("ints", ints);
+    s.put("strings", strings);
+
+    auto copy = ss::snapshot::deserialize(s.serialize());
+    check(copy && copy->size() == 4, "snapshot serialize");
+    check(s.save(path).has_value(), "snapshot save");
+    auto loaded = ss::snapshot::load(path);
+    check(loaded && loaded->size() == 4, "snapshot load");
+    if (loaded) {
+      auto st = loaded->get<ss::running_stats>("stats");
+      check(st && st->count() == 10'000 && st->sum() == stats.sum(), "running_stats entry");
+      auto sk = loaded->get<ss::quantile_sketch>("sketch");
+      check(sk && sk->count() == 10'000 && sk->quantile(0.5) == sketch.quantile(0.5), "sketch entry");
+      auto in = loaded->get<ss::int_group_aggregate>("ints");
+      check(in && in->size() == 7 && in->sketch(0), "int groups entry");
+      auto str = loaded->get<ss::string_group_aggregate>("strings");
+      check(str && str->find("odd") && str->find("odd")->stats.count() == 5'000, "string groups entry");
+      check(!loaded->get<ss::quantile_sketch>("stats"), "entry of another kind");
+    }
+  }
+
+  // aggregates with and without sketches, merged either way round
+  {
+    ss::int_group_aggregate a(64), b(0);
+    a.add(1, 1);
+    b.add(1, 2);
+    a.merge(b);
+    round_trip(a, int64_t{1}, 2, false, path, "sketched merged with unsketched");
+
+    ss::int_group_aggregate c(64), d(0);
+    c.add(1, 1);
+    d.add(1, 2);
+    d.merge(c);
+    round_trip(d, int64_t{1}, 2, false, path, "unsketched merged with sketched");
+
+    ss::string_group_aggregate e(64), f(16);
+    e.add("k", 1);
+    f.add("k", 2);
+    e.merge(f);
+    round_trip(e, string_view("k"), 2, true, path, "sketches of different k merged");
+
+    ss::int_group_aggregate g(64), empty(0);
+    g.add(1, 1);
+    g.merge(empty);
+    round_trip(g, int64_t{1}, 1, true, path, "merged with an empty unsketched aggregate");
+
+    ss::int_group_aggregate self(64);
+    for (int i = 0; i < 1'000; ++i) self.add(i % 10, i);
+    self.merge(self);
+    round_trip(self, int64_t{3}, 200, true, path, "merged with itself");
+  }
+
+  // shards with different sketch settings, combined as snapshots
+  {
+    ss::int_group_aggregate a(64), b(0);
+    a.add(1, 1);
+    b.add(1, 2);
+    b.add(2, 3);
+    ss::snapshot x, y;
+    x.put("groups", a);
+    y.put("groups", b);
+    auto merged = x.merge(y);
+    check(merged.has_value(), "snapshot merge across sketch settings");
+    check(x.save(path).has_value(), "merged snapshot save");
+    auto loaded = ss::snapshot::load(path);
+    auto groups = loaded ? loaded->get<ss::int_group_aggregate>("groups") : nullopt;
+    check(groups && groups->size() == 2 && groups->find(1)->stats.count() == 2, "merged snapshot load");
+  }
+
+  filesystem::remove(path);
+  println("{}", failures == 0 ? "ok" : "FAILED");
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,155 @@
+#ifndef SIMPLE_STATS_CONSTEXPR_H
+#define SIMPLE_STATS_CONSTEXPR_H
+
+// header-only companion to simple-stats.hh: the same statistics as
+// constexpr functions, so that tables known at compile time are reduced
+// by the compiler and only their results end up in the binary
+//
+//   constexpr std::array<int, 5> table = {3, 1, 4, 1, 5};
+//   constexpr auto mid = ss::median(table);  // 3.0, no call at run time
+//
+// nothing here is exported; the shared library's symbols are unchanged
+#include "simple-stats.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace ss {
+  /// constexpr forms of the ss entry points over spans; results agree
+  /// with the library's up to floating point rounding, as the library
+  /// sums in a different order
+  ///
+  /// sum, average and summarize are plain loops that the compiler can
+  /// also inline at run time. median and quantile select over a copy:
+  /// during constant evaluation a transient vector, at run time they call
+  /// the library instead, whose kernels do not allocate per call
+  namespace cx {
+    namespace detail {
+      constexpr auto nan() -> double { return std::numeric_limits<double>::quiet_NaN(); }
+
+      /// std::sqrt is not constexpr before C++26
+      constexpr auto sqrt(double x) -> double {
+          if !consteval {
+              return std::sqrt(x);
+          } else {
+              if (!(x > 0.0)) return x == 0.0 ? 0.0 : nan();
+              if (x == std::numeric_limits<double>::infinity()) return x;
+              // Newton's iteration from above converges monotonically
+              auto r = x < 1.0 ? 1.0 : x;
+              for (;;) {
+                  auto next = (r + x / r) / 2;
+                  if (next >= r) return r;
+                  r = next;
+              }
+          }
+      }
+
+      /// the q quantile of the unordered items, interpolating as the
+      /// library does; reorders items
+      template <typename T>
+      constexpr auto select_quantile(std::span<T> items, double q) -> double {
+          if (items.empty() || q != q) return nan();
+          auto n = items.size();
+          auto h = (n - 1) * std::clamp(q, 0.0, 1.0);
+          auto r = static_cast<std::size_t>(h);
+          std::nth_element(items.begin(), items.begin() + r, items.end());
+          auto x = static_cast<double>(items[r]);
+          if (r + 1 >= n || !(h > r)) return x;
+          // the next order statistic is the least of what lies above r
+          auto next = static_cast<double>(*std::min_element(items.begin() + r + 1, items.end()));
+          return x + (h - r) * (next - x);
+      }
+    }
+
+    template <sample T>
+    constexpr auto sum(std::span<const T> data) -> sum_type<T> {
+        sum_accumulator<T> total = 0;
+        for (auto v : data) total += static_cast<sum_accumulator<T>>(v);
+        return static_cast<sum_type<T>>(total);
+    }
+
+    template <sample T>
+    constexpr auto average(std::span<const T> data) -> double {
+        if (data.empty()) return detail::nan();
+        return static_cast<double>(sum(data)) / data.size();
+    }
+
+    /// two passes over the data, which costs nothing when it is constant
+    template <sample T>
+    constexpr auto summarize(std::span<const T> data) -> basic_summary<T> {
+        basic_summary<T> s;
+        s.count = data.size();
+        if (data.empty()) {
+            s.mean = s.variance = s.stddev = detail::nan();
+            return s;
+        }
+        s.sum = sum(data);
+        s.mean = static_cast<double>(s.sum) / s.count;
+        s.min = s.max = data[0];
+        double m2 = 0.0;
+        for (auto v : data) {
+            s.min = std::min(s.min, v);
+            s.max = std::max(s.max, v);
+            auto d = static_cast<double>(v) - s.mean;
+            m2 += d * d;
+        }
+        s.variance = m2 / s.count;
+        s.stddev = detail::sqrt(s.variance);
+        return s;
+    }
+
+    template <sample T>
+    constexpr auto quantile(std::span<const T> data, double q) -> double {
+        if !consteval {
+            double out;
+            ss::quantiles(data, std::span<const double>(&q, 1), std::span<double>(&out, 1));
+            return out;
+        } else {
+            std::vector<T> items(data.begin(), data.end());
+            return detail::select_quantile(std::span<T>(items), q);
+        }
+    }
+
+    template <sample T>
+    constexpr auto median(std::span<const T> data) -> double {
+        return quantile(data, 0.5);
+    }
+  }
+
+  // std::array overloads next to the library's, so constant tables read
+  // as ss::sum(table); the copy for selection lives on the stack, so these
+  // never call into the library and inline fully at run time
+
+  template <sample T, std::size_t N>
+  constexpr auto sum(const std::array<T, N>& data) -> sum_type<T> {
+      return cx::sum(std::span<const T>(data));
+  }
+
+  template <sample T, std::size_t N>
+  constexpr auto average(const std::array<T, N>& data) -> double {
+      return cx::average(std::span<const T>(data));
+  }
+
+  template <sample T, std::size_t N>
+  constexpr auto summarize(const std::array<T, N>& data) -> basic_summary<T> {
+      return cx::summarize(std::span<const T>(data));
+  }
+
+  template <sample T, std::size_t N>
+  constexpr auto quantile(const std::array<T, N>& data, double q) -> double {
+      auto items = data;
+      return cx::detail::select_quantile(std::span<T>(items), q);
+  }
+
+  template <sample T, std::size_t N>
+  constexpr auto median(const std::array<T, N>& data) -> double {
+      return quantile(data, 0.5);
+  }
+}
+
+#endif /* SIMPLE_STATS_CONSTEXPR_H */
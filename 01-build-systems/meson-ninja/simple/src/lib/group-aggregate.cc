@@ -0,0 +1,384 @@
+#include "group-aggregate.hh"
+#include "parallel-stats.hh"
+#include "thread-pool.hh"
+#include "wire.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace ss {
+  using namespace std;
+
+  namespace {
+    constexpr size_t min_slots = 16;
+
+    // tables smaller than this (256 KiB of slots) mostly stay in cache,
+    // where prefetching costs more than it saves
+    constexpr size_t prefetch_slots = size_t{1} << 15;
+
+    // string keys are packed into blocks of this size; longer keys get a
+    // block of their own
+    constexpr size_t block_bytes = size_t{64} << 10;
+
+    // partitions per thread for the parallel add, to leave something to
+    // steal when some keys are much hotter than others
+    constexpr size_t partitions_per_thread = 4;
+
+    constexpr uint8_t format_version = 1;
+    constexpr char format_magic[4] = {'s', 's', 'g', 'a'};
+
+    // the key type, as recorded in the serialized form
+    template <typename Key>
+    constexpr uint8_t key_code = is_same_v<Key, string_view> ? 2 : 1;
+
+    // a group's statistics take this many bytes; see stats_wire
+    constexpr size_t stats_bytes = 40;
+
+    // splitmix64's finalizer: every input bit reaches every output bit
+    auto mix(uint64_t x) -> uint64_t {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    auto prefetch(const void* p) -> void {
+#if defined(__GNUC__)
+        __builtin_prefetch(p);
+#else
+        static_cast<void>(p);
+#endif
+    }
+
+    auto hash_bytes(string_view s) -> uint64_t {
+        uint64_t h = 0x9e3779b97f4a7c15ull ^ s.size();
+        size_t i = 0;
+        for (; i + 8 <= s.size(); i += 8) {
+            uint64_t word;
+            memcpy(&word, s.data() + i, 8);
+            h = (h ^ word) * 0x100000001b3ull;
+            h = rotl(h, 29);
+        }
+        if (i < s.size()) {
+            uint64_t word = 0;
+            memcpy(&word, s.data() + i, s.size() - i);
+            h = (h ^ word) * 0x100000001b3ull;
+        }
+        return mix(h);
+    }
+  }
+
+  template <typename Key>
+  group_aggregate<Key>::group_aggregate(uint16_t sketch_k) : sketch_k_(sketch_k) {}
+
+  template <typename Key>
+  auto group_aggregate<Key>::hash(Key key) -> uint64_t {
+      if constexpr (is_same_v<Key, string_view>) {
+          return hash_bytes(key);
+      } else {
+          return mix(static_cast<uint64_t>(key));
+      }
+  }
+
+  template <typename Key>
+  auto group_aggregate<Key>::add(Key key, int value) -> void {
+      auto g = insert(key, hash(key));
+      groups_[g].stats.push(value);
+      if (sketch_k_ > 0) sketches_[g].add(value);
+  }
+
+  template <typename Key>
+  auto group_aggregate<Key>::add(span<const Key> keys, span<const int> values) -> void {
+      auto n = keys.size();
+      auto threads = n < parallel::serial_threshold() ? 1 : parallel::max_threads();
+      if (threads == 1) {
+          add_rows(keys, values);
+          return;
+      }
+
+      // the top bits of the hash pick a partition, the low bits a slot,
+      // so partitioning does not crowd keys together in the tables
+      auto& pool = detail::thread_pool::instance();
+      auto partitions = bit_ceil(threads * partitions_per_thread);
+      auto shift = 64 - countr_zero(partitions);
+      auto chunks = threads;
+      auto per_chunk = (n + chunks - 1) / chunks;
+
+      // hash every key once and count rows per (chunk, partition)
+      vector<uint64_t> hashes(n);
+      vector<size_t> counts(chunks * partitions);
+      pool.run(chunks, threads, [&](size_t c, size_t) {
+          auto* mine = &counts[c * partitions];
+          for (auto i = c * per_chunk; i < min(n, (c + 1) * per_chunk); ++i) {
+              hashes[i] = hash(keys[i]);
+              ++mine[hashes[i] >> shift];
+          }
+      });
+
+      // lay the rows out partition by partition; within a partition they
+      // stay in input order, so each group sees its values in order
+      vector<size_t> starts(partitions + 1);
+      for (size_t p = 0, at = 0; p < partitions; ++p) {
+          starts[p] = at;
+          for (size_t c = 0; c < chunks; ++c) at += exchange(counts[c * partitions + p], at);
+      }
+      starts[partitions] = n;
+      vector<size_t> rows(n);
+      pool.run(chunks, threads, [&](size_t c, size_t) {
+          auto* cursor = &counts[c * partitions];
+          for (auto i = c * per_chunk; i < min(n, (c + 1) * per_chunk); ++i) {
+              rows[cursor[hashes[i] >> shift]++] = i;
+          }
+      });
+
+      // partitions hold disjoint keys, so each is aggregated on its own
+      vector<group_aggregate> parts;
+      parts.reserve(partitions);
+      for (size_t p = 0; p < partitions; ++p) parts.emplace_back(sketch_k_);
+      pool.run(partitions, threads, [&](size_t p, size_t) {
+          auto& part = parts[p];
+          for (auto r = starts[p]; r < starts[p + 1]; ++r) {
+              auto i = rows[r];
+              auto g = part.insert(keys[i], hashes[i]);
+              part.groups_[g].stats.push(values[i]);
+              if (sketch_k_ > 0) part.sketches_[g].add(values[i]);
+          }
+      });
+      for (auto& part : parts) merge(part);
+  }
+
+  // with many groups nearly every row misses the cache twice, once on
+  // its slot and once on its group; hashing ahead lets both loads be
+  // started well before the row gets to them
+  template <typename Key>
+  auto group_aggregate<Key>::add_rows(span<const Key> keys, span<const int> values) -> void {
+      constexpr size_t ahead = 16;
+      uint64_t hashes[ahead];
+      auto n = keys.size();
+      for (size_t i = 0; i < min(n, ahead); ++i) hashes[i] = hash(keys[i]);
+
+      for (size_t i = 0; i < n; ++i) {
+          auto h = hashes[i % ahead];
+          auto large = slots_.size() >= prefetch_slots;
+          if (i + ahead < n) {
+              auto next = hashes[i % ahead] = hash(keys[i + ahead]);
+              if (large) prefetch(&slots_[next & (slots_.size() - 1)]);
+          }
+          if (large && i + ahead / 2 < n) {
+              auto near = slots_[hashes[(i + ahead / 2) % ahead] & (slots_.size() - 1)].index;
+              if (near != 0) prefetch(&groups_[near - 1]);
+          }
+
+          auto g = insert(keys[i], h);
+          groups_[g].stats.push(values[i]);
+          if (sketch_k_ > 0) sketches_[g].add(values[i]);
+      }
+  }
+
+  template <typename Key>
+  auto group_aggregate<Key>::merge(const group_aggregate& other) -> void {
+      if (&other == this) {
+          // every group meets itself; inserting would grow groups_ while
+          // it is being walked
+          for (size_t g = 0; g < groups_.size(); ++g) {
+              auto stats = groups_[g].stats;
+              groups_[g].stats.merge(stats);
+              if (sketch_k_ > 0) sketches_[g].merge(sketches_[g]);
+          }
+          return;
+      }
+      // other's rows reach no sketch here, so ours would fall behind the
+      // statistics; quantiles of the union cannot be answered, and the
+      // sketches go rather than answer for part of it
+      if (sketch_k_ > 0 && other.sketch_k_ == 0 && !other.groups_.empty()) {
+          sketch_k_ = 0;
+          sketches_.clear();
+      }
+      for (size_t i = 0; i < other.groups_.size(); ++i) {
+          auto g = insert(other.groups_[i].key, other.hashes_[i]);
+          groups_[g].stats.merge(other.groups_[i].stats);
+          if (sketch_k_ > 0) sketches_[g].merge(other.sketches_[i]);
+      }
+  }
+
+  template <typename Key>
+  auto group_aggregate<Key>::clear() -> void {
+      ranges::fill(slots_, slot{0, 0});
+      groups_.clear();
+      hashes_.clear();
+      sketches_.clear();
+      blocks_.clear();
+      block_left_ = 0;
+      block_next_ = nullptr;
+  }
+
+  template <typename Key>
+  auto group_aggregate<Key>::find(Key key) const -> const group<Key>* {
+      if (slots_.empty()) return nullptr;
+      auto h = hash(key);
+      auto tag = static_cast<uint32_t>(h >> 32);
+      auto mask = slots_.size() - 1;
+      for (auto i = h & mask;; i = (i + 1) & mask) {
+          auto s = slots_[i];
+          if (s.index == 0) return nullptr;
+          if (s.tag == tag && groups_[s.index - 1].key == key) return &groups_[s.index - 1];
+      }
+  }
+
+  // layout: magic[4] version:u8 key:u8 (1 int64, 2 string) sketch_k:u16
+  // groups:u64, then each group's running_stats body (see wire.hh). keys
+  // follow as groups i64s, or as groups u32 lengths and then the bytes of
+  // every string back to back; last, when sketch_k > 0, each group's
+  // sketch body. groups keep their order, and with it their indices
+  template <typename Key>
+  auto group_aggregate<Key>::serialize() const -> vector<byte> {
+      vector<byte> out;
+      out.reserve(16 + groups_.size() * (stats_bytes + sizeof(int64_t)));
+      for (auto c : format_magic) out.push_back(static_cast<byte>(c));
+      detail::put(out, format_version);
+      detail::put(out, key_code<Key>);
+      detail::put(out, sketch_k_);
+      detail::put(out, static_cast<uint64_t>(groups_.size()));
+      for (auto& g : groups_) detail::stats_wire::put(out, g.stats);
+
+      if constexpr (is_same_v<Key, string_view>) {
+          vector<uint32_t> lengths(groups_.size());
+          for (size_t i = 0; i < groups_.size(); ++i) lengths[i] = static_cast<uint32_t>(groups_[i].key.size());
+          detail::put_array(out, span<const uint32_t>(lengths));
+          for (auto& g : groups_) detail::put_bytes(out, as_bytes(span(g.key.data(), g.key.size())));
+      } else {
+          vector<int64_t> keys(groups_.size());
+          for (size_t i = 0; i < groups_.size(); ++i) keys[i] = groups_[i].key;
+          detail::put_array(out, span<const int64_t>(keys));
+      }
+
+      if (sketch_k_ > 0) {
+          for (auto& sketch : sketches_) detail::sketch_wire::put(out, sketch);
+      }
+      return out;
+  }
+
+  template <typename Key>
+  auto group_aggregate<Key>::deserialize(span<const byte> in) -> optional<group_aggregate> {
+      if (in.size() < sizeof(format_magic)) return nullopt;
+      for (size_t i = 0; i < sizeof(format_magic); ++i) {
+          if (in[i] != static_cast<byte>(format_magic[i])) return nullopt;
+      }
+      in = in.subspan(sizeof(format_magic));
+
+      uint8_t version = 0, key = 0;
+      uint16_t sketch_k = 0;
+      uint64_t count = 0;
+      if (!detail::get(in, version) || version != format_version) return nullopt;
+      if (!detail::get(in, key) || key != key_code<Key>) return nullopt;
+      if (!detail::get(in, sketch_k) || !detail::get(in, count)) return nullopt;
+      // bounds count by what the bytes can hold before anything is sized by it
+      if (count > in.size() / stats_bytes) return nullopt;
+
+      // statistics are decoded straight into the groups once they exist
+      auto stats = *detail::get_bytes(in, count * stats_bytes);
+
+      vector<Key> keys(count);
+      if constexpr (is_same_v<Key, string_view>) {
+          vector<uint32_t> lengths(count);
+          if (!detail::get_array(in, span<uint32_t>(lengths))) return nullopt;
+          uint64_t total = 0;
+          for (auto length : lengths) total += length;
+          auto text = detail::get_bytes(in, total);
+          if (!text) return nullopt;
+          auto* chars = reinterpret_cast<const char*>(text->data());
+          for (size_t i = 0; i < count; chars += lengths[i], ++i) keys[i] = {chars, lengths[i]};
+      } else {
+          if (!detail::get_array(in, span<int64_t>(keys))) return nullopt;
+      }
+
+      // the table is sized up front, so restoring never rehashes, and
+      // every key is hashed first so its slot can be fetched ahead of the
+      // insert. keys are copied into the arena, as the bytes may be a mapping
+      group_aggregate result(sketch_k);
+      result.slots_.assign(bit_ceil(max<size_t>(min_slots, (count + 1) * 2)), slot{0, 0});
+      result.groups_.reserve(count);
+      result.hashes_.reserve(count);
+      vector<uint64_t> hashes(count);
+      for (size_t i = 0; i < count; ++i) hashes[i] = hash(keys[i]);
+      constexpr size_t ahead = 16;
+      auto mask = result.slots_.size() - 1;
+      for (size_t i = 0; i < count; ++i) {
+          if (i + ahead < count) prefetch(&result.slots_[hashes[i + ahead] & mask]);
+          if (result.insert(keys[i], hashes[i]) != i) return nullopt;  // duplicate key
+      }
+      for (auto& g : result.groups_) {
+          auto s = detail::stats_wire::get(stats);
+          if (!s || s->count() == 0) return nullopt;
+          g.stats = *s;
+      }
+
+      if (sketch_k > 0) {
+          for (size_t i = 0; i < count; ++i) {
+              auto sketch = detail::sketch_wire::get(in);
+              if (!sketch || sketch->count() != result.groups_[i].stats.count()) return nullopt;
+              result.sketches_[i] = std::move(*sketch);
+          }
+      }
+      if (!in.empty()) return nullopt;
+      return result;
+  }
+
+  template <typename Key>
+  auto group_aggregate<Key>::insert(Key key, uint64_t h) -> size_t {
+      if ((groups_.size() + 1) * 2 > slots_.size()) grow();
+
+      auto tag = static_cast<uint32_t>(h >> 32);
+      auto mask = slots_.size() - 1;
+      for (auto i = h & mask;; i = (i + 1) & mask) {
+          auto& s = slots_[i];
+          if (s.index == 0) {
+              groups_.push_back({store(key), {}});
+              hashes_.push_back(h);
+              if (sketch_k_ > 0) sketches_.emplace_back(sketch_k_);
+              s = {tag, static_cast<uint32_t>(groups_.size())};
+              return groups_.size() - 1;
+          }
+          if (s.tag == tag && groups_[s.index - 1].key == key) return s.index - 1;
+      }
+  }
+
+  template <typename Key>
+  auto group_aggregate<Key>::grow() -> void {
+      vector<slot> slots(max(min_slots, slots_.size() * 2), slot{0, 0});
+      auto mask = slots.size() - 1;
+      for (size_t g = 0; g < groups_.size(); ++g) {
+          auto i = hashes_[g] & mask;
+          while (slots[i].index != 0) i = (i + 1) & mask;
+          slots[i] = {static_cast<uint32_t>(hashes_[g] >> 32), static_cast<uint32_t>(g + 1)};
+      }
+      slots_ = std::move(slots);
+  }
+
+  template <typename Key>
+  auto group_aggregate<Key>::store(Key key) -> Key {
+      if constexpr (is_same_v<Key, string_view>) {
+          if (key.empty()) return {};
+          if (key.size() > block_left_) {
+              auto bytes = max(block_bytes, key.size());
+              blocks_.push_back(make_unique_for_overwrite<char[]>(bytes));
+              block_next_ = blocks_.back().get();
+              block_left_ = bytes;
+          }
+          auto* copy = block_next_;
+          memcpy(copy, key.data(), key.size());
+          block_next_ += key.size();
+          block_left_ -= key.size();
+          return {copy, key.size()};
+      } else {
+          return key;
+      }
+  }
+
+  template class group_aggregate<int64_t>;
+  template class group_aggregate<string_view>;
+}
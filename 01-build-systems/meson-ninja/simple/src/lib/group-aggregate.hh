@@ -0,0 +1,118 @@
+#ifndef SIMPLE_STATS_GROUP_AGGREGATE_H
+#define SIMPLE_STATS_GROUP_AGGREGATE_H
+
+#include "quantile-sketch.hh"
+#include "running-stats.hh"
+#include "simple-stats.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ss {
+  /// one group of a group_aggregate: its key and the running statistics
+  /// of the values added under it
+  template <typename Key>
+  struct group {
+    Key key;
+    running_stats stats;
+  };
+
+  /// "aggregate value grouped by key" without sorting: each (key, value)
+  /// row is folded into its group's running_stats, and optionally into a
+  /// per-group quantile_sketch for medians and other quantiles
+  ///
+  /// groups live in one dense vector (in order of first appearance when
+  /// rows are added serially) and are found through an open-addressing
+  /// table (linear probing, at most half full) whose 8-byte slots carry
+  /// 32 bits of the key's hash, so a probe rarely touches a group it
+  /// does not want. string keys are copied into an arena of large blocks
+  /// that never move; the views in groups() stay valid until clear() or
+  /// destruction
+  ///
+  /// batches passed to add() at least parallel::serial_threshold() long
+  /// are split by key hash into partitions with disjoint keys, each
+  /// aggregated by one thread of the ss::parallel pool, and merged into
+  /// this aggregate at the end
+  ///
+  /// instantiated for std::int64_t and std::string_view keys
+  template <typename Key>
+  class STATS_API group_aggregate {
+  public:
+    /// sketch_k > 0 keeps a quantile_sketch with that k for every group;
+    /// 0 keeps running statistics only
+    explicit group_aggregate(std::uint16_t sketch_k = 0);
+
+    group_aggregate(group_aggregate&&) noexcept = default;
+    auto operator=(group_aggregate&&) noexcept -> group_aggregate& = default;
+    group_aggregate(const group_aggregate&) = delete;
+    auto operator=(const group_aggregate&) -> group_aggregate& = delete;
+
+    /// fold one row into its group, creating the group if it is new
+    auto add(Key key, int value) -> void;
+
+    /// fold rows (keys[i], values[i]); keys and values are equally long
+    auto add(std::span<const Key> keys, std::span<const int> values) -> void;
+
+    /// fold every group of other into this aggregate, as if its rows had
+    /// been added here. sketches are merged when both aggregates keep
+    /// them; when only this one does, it stops keeping them (sketch()
+    /// returns nullptr), as they would not have seen other's rows
+    auto merge(const group_aggregate& other) -> void;
+
+    /// drop every group, keeping the table storage
+    auto clear() -> void;
+
+    auto size() const -> std::size_t { return groups_.size(); }
+    auto groups() const -> std::span<const group<Key>> { return groups_; }
+
+    /// the group for key, or nullptr; invalidated by the next add or merge
+    auto find(Key key) const -> const group<Key>*;
+
+    /// the sketch of groups()[i], or nullptr when sketches are not kept
+    auto sketch(std::size_t i) const -> const quantile_sketch* {
+        return sketches_.empty() ? nullptr : &sketches_[i];
+    }
+
+    /// every group with its key, statistics and sketch in a little-endian
+    /// layout, string keys included, so the aggregate can be restored by
+    /// another process without replaying its rows
+    auto serialize() const -> std::vector<std::byte>;
+
+    /// inverse of serialize(); nullopt when bytes are truncated, from
+    /// another format version or key type, or internally inconsistent
+    static auto deserialize(std::span<const std::byte> bytes) -> std::optional<group_aggregate>;
+
+  private:
+    struct slot {
+        std::uint32_t tag;    // high half of the key's hash
+        std::uint32_t index;  // 1 + index into groups_, 0 when empty
+    };
+
+    static auto hash(Key key) -> std::uint64_t;
+    auto add_rows(std::span<const Key> keys, std::span<const int> values) -> void;
+    auto insert(Key key, std::uint64_t h) -> std::size_t;
+    auto grow() -> void;
+    auto store(Key key) -> Key;
+
+    std::uint16_t sketch_k_;
+    std::vector<slot> slots_;
+    std::vector<group<Key>> groups_;
+    std::vector<std::uint64_t> hashes_;
+    std::vector<quantile_sketch> sketches_;
+
+    // arena for string keys
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    std::size_t block_left_ = 0;
+    char* block_next_ = nullptr;
+  };
+
+  using int_group_aggregate = group_aggregate<std::int64_t>;
+  using string_group_aggregate = group_aggregate<std::string_view>;
+}
+
+#endif /* SIMPLE_STATS_GROUP_AGGREGATE_H */
@@ -0,0 +1,184 @@
+#include "instrumentation.hh"
+#include "probe.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <mutex>
+
+namespace ss::instrumentation {
+  using namespace std;
+
+  namespace {
+    constexpr string_view probe_names[probe_count] = {
+        "sum",
+        "average",
+        "summarize",
+        "median",
+        "quantiles",
+        "parallel::sum",
+        "parallel::average",
+        "parallel::summarize",
+        "parallel::median",
+        "parallel::quantiles",
+    };
+
+#if defined(STATS_API_INSTRUMENT) && STATS_API_INSTRUMENT
+    // one thread's counters. only the owning thread writes them, so a
+    // relaxed load and store stand in for an atomic add; the atomics are
+    // there so that readers on other threads see whole values
+    struct counters {
+        atomic<uint64_t> calls{0};
+        atomic<uint64_t> elements{0};
+        atomic<uint64_t> total_ns{0};
+        array<atomic<uint64_t>, histogram_buckets> histogram = {};
+    };
+
+    auto bump(atomic<uint64_t>& c, uint64_t by) -> void {
+        c.store(c.load(memory_order_relaxed) + by, memory_order_relaxed);
+    }
+
+    auto add_to(probe_counts& total, const counters& c) -> void {
+        total.calls += c.calls.load(memory_order_relaxed);
+        total.elements += c.elements.load(memory_order_relaxed);
+        total.total_ns += c.total_ns.load(memory_order_relaxed);
+        for (size_t b = 0; b < histogram_buckets; ++b) {
+            total.histogram[b] += c.histogram[b].load(memory_order_relaxed);
+        }
+    }
+
+    struct thread_block;
+
+    // live blocks, the sums left by exited threads, and the totals at the
+    // last reset, which reads subtract rather than zeroing counters that
+    // other threads are writing
+    struct registry {
+        mutex lock;
+        vector<thread_block*> blocks;
+        array<probe_counts, probe_count> retired = {};
+        array<probe_counts, probe_count> baseline = {};
+    };
+
+    // never destroyed, as threads may still exit after static destruction
+    auto the_registry() -> registry& {
+        static auto* r = new registry;
+        return *r;
+    }
+
+    struct thread_block {
+        array<counters, probe_count> probes;
+
+        thread_block() {
+            auto& r = the_registry();
+            lock_guard guard(r.lock);
+            r.blocks.push_back(this);
+        }
+
+        ~thread_block() {
+            auto& r = the_registry();
+            lock_guard guard(r.lock);
+            for (size_t p = 0; p < probe_count; ++p) add_to(r.retired[p], probes[p]);
+            erase(r.blocks, this);
+        }
+    };
+
+    auto totals(registry& r) -> array<probe_counts, probe_count> {
+        auto out = r.retired;
+        for (auto* block : r.blocks) {
+            for (size_t p = 0; p < probe_count; ++p) add_to(out[p], block->probes[p]);
+        }
+        return out;
+    }
+#endif
+  }
+
+  auto name(probe p) -> string_view {
+      auto i = static_cast<size_t>(p);
+      return i < probe_count ? probe_names[i] : "unknown";
+  }
+
+#if defined(STATS_API_INSTRUMENT) && STATS_API_INSTRUMENT
+  auto enabled() -> bool { return true; }
+
+  auto read() -> vector<probe_counts> {
+      auto& r = the_registry();
+      lock_guard guard(r.lock);
+      auto now = totals(r);
+      vector<probe_counts> out(probe_count);
+      for (size_t p = 0; p < probe_count; ++p) {
+          auto& base = r.baseline[p];
+          out[p] = now[p];
+          out[p].which = static_cast<probe>(p);
+          out[p].calls -= base.calls;
+          out[p].elements -= base.elements;
+          out[p].total_ns -= base.total_ns;
+          for (size_t b = 0; b < histogram_buckets; ++b) out[p].histogram[b] -= base.histogram[b];
+      }
+      return out;
+  }
+
+  auto reset() -> void {
+      auto& r = the_registry();
+      lock_guard guard(r.lock);
+      r.baseline = totals(r);
+  }
+#else
+  auto enabled() -> bool { return false; }
+
+  auto read() -> vector<probe_counts> {
+      vector<probe_counts> out(probe_count);
+      for (size_t p = 0; p < probe_count; ++p) out[p].which = static_cast<probe>(p);
+      return out;
+  }
+
+  auto reset() -> void {}
+#endif
+
+  auto read(probe p) -> probe_counts {
+      auto all = read();
+      auto i = static_cast<size_t>(p);
+      return i < all.size() ? all[i] : probe_counts{p};
+  }
+
+  auto to_json() -> string {
+      string out = "{\"enabled\": ";
+      out += enabled() ? "true" : "false";
+      out += ", \"probes\": [";
+      auto first = true;
+      for (auto& c : read()) {
+          if (c.calls == 0) continue;
+          out += first ? "\n  " : ",\n  ";
+          first = false;
+          out += "{\"name\": \"";
+          out += name(c.which);
+          out += "\", \"calls\": " + to_string(c.calls);
+          out += ", \"elements\": " + to_string(c.elements);
+          out += ", \"total_ns\": " + to_string(c.total_ns);
+          out += ", \"histogram_ns\": [";
+          auto used = histogram_buckets;
+          while (used > 0 && c.histogram[used - 1] == 0) --used;
+          for (size_t b = 0; b < used; ++b) {
+              if (b > 0) out += ", ";
+              out += to_string(c.histogram[b]);
+          }
+          out += "]}";
+      }
+      out += first ? "]}\n" : "\n]}\n";
+      return out;
+  }
+}
+
+#if defined(STATS_API_INSTRUMENT) && STATS_API_INSTRUMENT
+namespace ss::detail {
+  auto record(instrumentation::probe p, std::uint64_t elements, std::uint64_t ns) -> void {
+      using namespace instrumentation;
+      thread_local thread_block block;
+      auto& c = block.probes[static_cast<std::size_t>(p)];
+      bump(c.calls, 1);
+      bump(c.elements, elements);
+      bump(c.total_ns, ns);
+      auto bucket = ns == 0 ? 0 : static_cast<std::size_t>(std::bit_width(ns) - 1);
+      bump(c.histogram[std::min(bucket, histogram_buckets - 1)], 1);
+  }
+}
+#endif
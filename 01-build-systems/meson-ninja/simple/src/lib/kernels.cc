@@ -0,0 +1,125 @@
+#include "kernels.hh"
+
+#include <numeric>
+#include <vector>
+
+#if defined(__x86_64__)
+#  define SS_X86_KERNELS 1
+#  include <immintrin.h>
+#elif defined(__aarch64__)
+#  define SS_NEON_KERNELS 1
+#  include <arm_neon.h>
+#endif
+
+namespace ss::detail {
+  using namespace std;
+
+  auto sum_i32_scalar(const int* data, size_t n) -> int64_t {
+      return accumulate(data, data + n, int64_t{0});
+  }
+
+  namespace {
+#if defined(SS_X86_KERNELS)
+    // each kernel sign-extends 32-bit lanes to 64-bit before adding, so
+    // no total that fits in an int64_t can overflow; two independent
+    // accumulators keep the adds from serializing on one register
+
+    __attribute__((target("sse4.2")))
+    auto sum_i32_sse42(const int* data, size_t n) -> int64_t {
+        auto acc0 = _mm_setzero_si128();
+        auto acc1 = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            auto v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 4));
+            acc0 = _mm_add_epi64(acc0, _mm_cvtepi32_epi64(v0));
+            acc1 = _mm_add_epi64(acc1, _mm_cvtepi32_epi64(_mm_srli_si128(v0, 8)));
+            acc0 = _mm_add_epi64(acc0, _mm_cvtepi32_epi64(v1));
+            acc1 = _mm_add_epi64(acc1, _mm_cvtepi32_epi64(_mm_srli_si128(v1, 8)));
+        }
+        auto acc = _mm_add_epi64(acc0, acc1);
+        int64_t total = _mm_cvtsi128_si64(acc) + _mm_extract_epi64(acc, 1);
+        return total + sum_i32_scalar(data + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    auto sum_i32_avx2(const int* data, size_t n) -> int64_t {
+        auto acc0 = _mm256_setzero_si256();
+        auto acc1 = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            auto p = reinterpret_cast<const __m128i*>(data + i);
+            acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm_loadu_si128(p + 0)));
+            acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm_loadu_si128(p + 1)));
+            acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm_loadu_si128(p + 2)));
+            acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm_loadu_si128(p + 3)));
+        }
+        auto acc = _mm256_add_epi64(acc0, acc1);
+        auto half = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        int64_t total = _mm_cvtsi128_si64(half) + _mm_extract_epi64(half, 1);
+        return total + sum_i32_scalar(data + i, n - i);
+    }
+
+    __attribute__((target("avx512f")))
+    auto sum_i32_avx512(const int* data, size_t n) -> int64_t {
+        auto acc0 = _mm512_setzero_si512();
+        auto acc1 = _mm512_setzero_si512();
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            auto p = reinterpret_cast<const __m256i*>(data + i);
+            acc0 = _mm512_add_epi64(acc0, _mm512_cvtepi32_epi64(_mm256_loadu_si256(p + 0)));
+            acc1 = _mm512_add_epi64(acc1, _mm512_cvtepi32_epi64(_mm256_loadu_si256(p + 1)));
+            acc0 = _mm512_add_epi64(acc0, _mm512_cvtepi32_epi64(_mm256_loadu_si256(p + 2)));
+            acc1 = _mm512_add_epi64(acc1, _mm512_cvtepi32_epi64(_mm256_loadu_si256(p + 3)));
+        }
+        int64_t total = _mm512_reduce_add_epi64(_mm512_add_epi64(acc0, acc1));
+        return total + sum_i32_scalar(data + i, n - i);
+    }
+#endif /* SS_X86_KERNELS */
+
+#if defined(SS_NEON_KERNELS)
+    // neon is baseline on aarch64, so there is nothing to dispatch on;
+    // vpadalq pairwise-adds 32-bit lanes into 64-bit accumulators
+    auto sum_i32_neon(const int* data, size_t n) -> int64_t {
+        auto acc0 = vdupq_n_s64(0);
+        auto acc1 = vdupq_n_s64(0);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            acc0 = vpadalq_s32(acc0, vld1q_s32(data + i));
+            acc1 = vpadalq_s32(acc1, vld1q_s32(data + i + 4));
+        }
+        int64_t total = vaddvq_s64(vaddq_s64(acc0, acc1));
+        return total + sum_i32_scalar(data + i, n - i);
+    }
+#endif /* SS_NEON_KERNELS */
+
+    auto supported_sum_i32() -> vector<sum_i32_kernel> {
+        vector<sum_i32_kernel> kernels;
+#if defined(SS_X86_KERNELS)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) kernels.push_back({sum_i32_avx512, "avx512"});
+        if (__builtin_cpu_supports("avx2"))    kernels.push_back({sum_i32_avx2, "avx2"});
+        if (__builtin_cpu_supports("sse4.2"))  kernels.push_back({sum_i32_sse42, "sse4.2"});
+#elif defined(SS_NEON_KERNELS)
+        kernels.push_back({sum_i32_neon, "neon"});
+#endif
+        kernels.push_back({sum_i32_scalar, "scalar"});
+        return kernels;
+    }
+  }
+
+  auto sum_i32_kernels() -> span<const sum_i32_kernel> {
+      static const auto kernels = supported_sum_i32();
+      return kernels;
+  }
+
+  // the widest kernel wins; the list is built once, on first call
+
+  auto sum_i32_kernel_name() -> const char* {
+      return sum_i32_kernels().front().name;
+  }
+
+  auto sum_i32(const int* data, size_t n) -> int64_t {
+      return sum_i32_kernels().front().fn(data, n);
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef SIMPLE_STATS_KERNELS_H
+#define SIMPLE_STATS_KERNELS_H
+
+// internal to the ss library; not part of the public interface, so it
+// is neither installed nor included by simple-stats.hh
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace ss::detail {
+  /// signature shared by every reduction kernel variant
+  using sum_i32_fn = auto (*)(const int* data, std::size_t n) -> std::int64_t;
+
+  /// portable reference implementation; every other kernel must agree
+  /// with it bit for bit
+  auto sum_i32_scalar(const int* data, std::size_t n) -> std::int64_t;
+
+  /// a kernel variant and its name (e.g. "avx2")
+  struct sum_i32_kernel {
+    sum_i32_fn fn;
+    const char* name;
+  };
+
+  /// every variant built in that the running cpu can execute, widest
+  /// first and scalar last, so each can be checked against the others
+  auto sum_i32_kernels() -> std::span<const sum_i32_kernel>;
+
+  /// name of the kernel picked for this cpu (e.g. "avx2"), for logging
+  auto sum_i32_kernel_name() -> const char*;
+
+  /// widening sum of 32-bit integers into a 64-bit accumulator, using
+  /// the widest instruction set the running cpu supports; the choice is
+  /// made once, on first call
+  auto sum_i32(const int* data, std::size_t n) -> std::int64_t;
+}
+
+#endif /* SIMPLE_STATS_KERNELS_H */
@@ -0,0 +1,206 @@
+#include "parallel-stats.hh"
+#include "kernels.hh"
+#include "probe.hh"
+#include "running-stats.hh"
+#include "select.hh"
+#include "thread-pool.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace ss::parallel {
+  using namespace std;
+  using detail::thread_pool;
+
+  namespace {
+    constexpr size_t page_bytes = 4096;
+    constexpr size_t page_ints = page_bytes / sizeof(int);
+
+    // chunks are at least this long (256 KiB of ints), so the cost of
+    // handing one out is lost in the cost of reading it
+    constexpr size_t min_chunk = size_t{1} << 16;
+
+    // aim for this many chunks per thread, to leave something to steal
+    constexpr size_t chunks_per_thread = 8;
+
+    atomic<size_t> thread_limit{0};
+    atomic<size_t> threshold{size_t{1} << 20};
+
+    // splits data at page boundaries of the underlying memory
+    struct chunking {
+        chunking(span<const int> data, size_t threads) : data(data) {
+            auto per = max(min_chunk, data.size() / (threads * chunks_per_thread));
+            per = (per + page_ints - 1) / page_ints * page_ints;
+            count = (data.size() + per - 1) / per;
+            stride = per;
+        }
+
+        auto boundary(size_t i) const -> size_t {
+            if (i == 0) return 0;
+            if (i >= count) return data.size();
+            auto base = reinterpret_cast<uintptr_t>(data.data());
+            auto raw = base + i * stride * sizeof(int);
+            auto aligned = (raw + page_bytes - 1) & ~(uintptr_t{page_bytes} - 1);
+            return min(data.size(), (aligned - base) / sizeof(int));
+        }
+
+        auto operator[](size_t i) const -> span<const int> {
+            auto first = boundary(i);
+            return data.subspan(first, boundary(i + 1) - first);
+        }
+
+        span<const int> data;
+        size_t stride;
+        size_t count;
+    };
+
+    // per-participant values padded apart so that threads updating their
+    // own slot do not share a cache line
+    template <typename T>
+    struct alignas(64) padded {
+        T value;
+    };
+
+    auto threads_for(size_t n) -> size_t {
+        return n == 0 || n < serial_threshold() ? 1 : max_threads();
+    }
+  }
+
+  auto max_threads() -> size_t {
+      auto limit = thread_limit.load(memory_order_relaxed);
+      return limit != 0 ? limit : max(1u, thread::hardware_concurrency());
+  }
+
+  auto set_max_threads(size_t n) -> void {
+      thread_limit.store(max<size_t>(n, 1), memory_order_relaxed);
+  }
+
+  auto serial_threshold() -> size_t {
+      return threshold.load(memory_order_relaxed);
+  }
+
+  auto set_serial_threshold(size_t n) -> void {
+      threshold.store(n, memory_order_relaxed);
+  }
+
+  auto sum(span<const int> data) -> int64_t {
+      SS_PROBE(parallel_sum, data.size());
+      auto threads = threads_for(data.size());
+      if (threads == 1) return detail::sum_i32(data.data(), data.size());
+
+      chunking chunks(data, threads);
+      vector<int64_t> partial(chunks.count);
+      thread_pool::instance().run(chunks.count, threads, [&](size_t c, size_t) {
+          auto part = chunks[c];
+          partial[c] = detail::sum_i32(part.data(), part.size());
+      });
+
+      int64_t total = 0;
+      for (auto p : partial) total += p;
+      return total;
+  }
+
+  auto average(span<const int> data) -> double {
+      SS_PROBE(parallel_average, data.size());
+      return static_cast<double>(sum(data)) / data.size();
+  }
+
+  auto summarize(span<const int> data) -> summary {
+      SS_PROBE(parallel_summarize, data.size());
+      auto threads = threads_for(data.size());
+      running_stats total;
+      if (threads == 1) {
+          total.push(data);
+          return total.snapshot();
+      }
+
+      // merging in chunk order keeps the result independent of which
+      // thread happened to run which chunk
+      chunking chunks(data, threads);
+      vector<running_stats> partial(chunks.count);
+      thread_pool::instance().run(chunks.count, threads, [&](size_t c, size_t) {
+          partial[c].push(chunks[c]);
+      });
+      for (auto& p : partial) total.merge(p);
+      return total.snapshot();
+  }
+
+  auto median(span<const int> data) -> double {
+      SS_PROBE(parallel_median, data.size());
+      constexpr double half = 0.5;
+      double result;
+      quantiles(data, span(&half, 1), span(&result, 1));
+      return result;
+  }
+
+  // the same radix selection as ss::quantiles with each pass split over
+  // the pool: min/max, per-thread bucket histograms, then per-thread
+  // gathering of just the buckets that hold a requested rank
+  auto quantiles(span<const int> data, span<const double> qs, span<double> out) -> void {
+      SS_PROBE(parallel_quantiles, data.size());
+      auto threads = threads_for(data.size());
+      if (threads == 1) {
+          ss::quantiles(data, qs, out);
+          return;
+      }
+
+      auto& a = detail::thread_arena();
+      detail::collect_ranks(data.size(), qs, a.ranks);
+      a.values.resize(a.ranks.size());
+      if (!a.ranks.empty()) {
+          auto& pool = thread_pool::instance();
+          chunking chunks(data, threads);
+          auto participants = min(threads, pool.capacity());
+
+          vector<padded<pair<int, int>>> bounds(participants,
+              {{numeric_limits<int>::max(), numeric_limits<int>::min()}});
+          pool.run(chunks.count, threads, [&](size_t c, size_t who) {
+              auto part = chunks[c];
+              if (part.empty()) return;
+              auto [lo, hi] = ranges::minmax(part);
+              auto& b = bounds[who].value;
+              b = {min(b.first, lo), max(b.second, hi)};
+          });
+          int lo = numeric_limits<int>::max(), hi = numeric_limits<int>::min();
+          for (auto& b : bounds) {
+              lo = min(lo, b.value.first);
+              hi = max(hi, b.value.second);
+          }
+
+          detail::radix_buckets bucket(lo, hi, data.size());
+          vector<vector<size_t>> histograms(participants);
+          pool.run(chunks.count, threads, [&](size_t c, size_t who) {
+              auto& h = histograms[who];
+              if (h.empty()) h.assign(bucket.size, 0);
+              for (auto v : chunks[c]) ++h[bucket(v)];
+          });
+          a.counts.assign(bucket.size, 0);
+          for (auto& h : histograms) {
+              for (size_t b = 0; b < h.size(); ++b) a.counts[b] += h[b];
+          }
+
+          a.items.resize(detail::plan_gather(a));
+          auto slots = a.cursors.size();
+          vector<vector<vector<int>>> gathered(participants);
+          pool.run(chunks.count, threads, [&](size_t c, size_t who) {
+              auto& mine = gathered[who];
+              if (mine.empty()) mine.resize(slots);
+              for (auto v : chunks[c]) {
+                  if (auto slot = a.counts[bucket(v)]) mine[slot - 1].push_back(v);
+              }
+          });
+          for (size_t s = 0; s < slots; ++s) {
+              auto pos = a.items.begin() + a.cursors[s];
+              for (auto& mine : gathered) {
+                  if (!mine.empty()) pos = ranges::copy(mine[s], pos).out;
+              }
+          }
+          detail::select_gathered(a);
+      }
+      detail::interpolate<int>(data.size(), qs, a.ranks, a.values, out);
+  }
+}
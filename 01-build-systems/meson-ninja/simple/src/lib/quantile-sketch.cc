@@ -0,0 +1,214 @@
+#include "quantile-sketch.hh"
+#include "wire.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace ss {
+  using namespace std;
+
+  namespace {
+    // capacity of level h shrinks by this factor per level below the top,
+    // but never below min_capacity so the lowest levels compact in batches
+    constexpr double capacity_decay = 2.0 / 3.0;
+    constexpr size_t min_capacity = 8;
+
+    // empirical fit for the single-quantile error of KLL at 99%
+    // confidence, as published with the Apache DataSketches implementation
+    constexpr double error_scale = 2.296;
+    constexpr double error_exponent = 0.9723;
+
+    constexpr uint8_t format_version = 1;
+    constexpr char format_magic[4] = {'s', 's', 'q', 's'};
+  }
+
+  quantile_sketch::quantile_sketch(uint16_t k)
+      : k_(max<uint16_t>(k, 8)),
+        min_(numeric_limits<int>::max()),
+        max_(numeric_limits<int>::min()),
+        coin_(0x9e3779b97f4a7c15ull),
+        levels_(1) {
+      update_limit();
+  }
+
+  auto quantile_sketch::for_rank_error(double epsilon) -> quantile_sketch {
+      auto k = ceil(pow(error_scale / epsilon, 1.0 / error_exponent));
+      return quantile_sketch(static_cast<uint16_t>(clamp(k, 8.0, 65535.0)));
+  }
+
+  auto quantile_sketch::rank_error() const -> double {
+      return error_scale / pow(static_cast<double>(k_), error_exponent);
+  }
+
+  // capacities only change when a level is added, so they are worked
+  // out here rather than on every compaction
+  auto quantile_sketch::update_limit() -> void {
+      capacities_.resize(levels_.size());
+      limit_ = 0;
+      for (size_t h = 0; h < levels_.size(); ++h) {
+          auto depth = levels_.size() - 1 - h;
+          auto cap = ceil(k_ * pow(capacity_decay, static_cast<double>(depth)));
+          capacities_[h] = max<size_t>(min_capacity, static_cast<size_t>(cap));
+          limit_ += capacities_[h];
+      }
+  }
+
+  auto quantile_sketch::compress() -> void {
+      while (retained_ > limit_) {
+          // some level must be at or over its capacity, or the total
+          // could not be over the sum of capacities
+          size_t h = 0;
+          while (levels_[h].size() < capacities_[h]) ++h;
+
+          if (h + 1 == levels_.size()) {
+              levels_.emplace_back();
+              update_limit();
+          }
+
+          // levels above 0 are kept sorted, so only the raw input
+          // buffer ever needs a full sort
+          auto& src = levels_[h];
+          auto& dst = levels_[h + 1];
+          if (h == 0) ranges::sort(src);
+          auto old_size = dst.size();
+
+          // an odd item out stays behind at this level with its weight
+          size_t keep = src.size() % 2;
+          coin_ ^= coin_ << 13;
+          coin_ ^= coin_ >> 7;
+          coin_ ^= coin_ << 17;
+          for (size_t i = keep + (coin_ & 1); i < src.size(); i += 2) {
+              dst.push_back(src[i]);
+          }
+          inplace_merge(dst.begin(), dst.begin() + old_size, dst.end());
+          retained_ -= (src.size() - keep) / 2;
+          src.resize(keep);
+      }
+  }
+
+  auto quantile_sketch::add(span<const int> values) -> void {
+      for (auto v : values) add(v);
+  }
+
+  auto quantile_sketch::merge(const quantile_sketch& other) -> void {
+      if (other.n_ == 0) return;
+      if (&other == this) {
+          // the levels below grow while being read from
+          auto copy = other;
+          merge(copy);
+          return;
+      }
+      if (other.levels_.size() > levels_.size()) {
+          levels_.resize(other.levels_.size());
+          update_limit();
+      }
+      for (size_t h = 0; h < other.levels_.size(); ++h) {
+          auto& level = levels_[h];
+          auto old_size = level.size();
+          level.insert(level.end(), other.levels_[h].begin(), other.levels_[h].end());
+          if (h > 0) inplace_merge(level.begin(), level.begin() + old_size, level.end());
+      }
+      n_ += other.n_;
+      min_ = std::min(min_, other.min_);
+      max_ = std::max(max_, other.max_);
+      retained_ += other.retained_;
+      compress();
+  }
+
+  auto quantile_sketch::quantile(double q) const -> double {
+      if (n_ == 0 || isnan(q)) return numeric_limits<double>::quiet_NaN();
+      if (q <= 0.0) return min_;
+      if (q >= 1.0) return max_;
+
+      vector<pair<int, uint64_t>> items;
+      items.reserve(retained_);
+      for (size_t h = 0; h < levels_.size(); ++h) {
+          for (auto v : levels_[h]) items.emplace_back(v, uint64_t{1} << h);
+      }
+      ranges::sort(items, {}, &pair<int, uint64_t>::first);
+
+      auto target = q * static_cast<double>(n_);
+      uint64_t seen = 0;
+      for (auto& [value, weight] : items) {
+          seen += weight;
+          if (static_cast<double>(seen) >= target) return value;
+      }
+      return max_;
+  }
+
+  // layout: magic[4] version:u8, then the body written by sketch_wire
+  auto quantile_sketch::serialize() const -> vector<byte> {
+      vector<byte> out;
+      out.reserve(24 + 4 * levels_.size() + 4 * retained_);
+      for (auto c : format_magic) out.push_back(static_cast<byte>(c));
+      detail::put(out, format_version);
+      detail::sketch_wire::put(out, *this);
+      return out;
+  }
+
+  auto quantile_sketch::deserialize(span<const byte> in) -> optional<quantile_sketch> {
+      if (in.size() < sizeof(format_magic)) return nullopt;
+      for (size_t i = 0; i < sizeof(format_magic); ++i) {
+          if (in[i] != static_cast<byte>(format_magic[i])) return nullopt;
+      }
+      in = in.subspan(sizeof(format_magic));
+
+      uint8_t version = 0;
+      if (!detail::get(in, version) || version != format_version) return nullopt;
+      auto sketch = detail::sketch_wire::get(in);
+      if (!sketch || !in.empty()) return nullopt;
+      return sketch;
+  }
+
+  // body: levels:u8 k:u16 n:u64 min:i32 max:i32, then for each level
+  // size:u32 followed by size items as i32
+  auto detail::sketch_wire::put(vector<byte>& out, const quantile_sketch& s) -> void {
+      detail::put(out, static_cast<uint8_t>(s.levels_.size()));
+      detail::put(out, s.k_);
+      detail::put(out, s.n_);
+      detail::put(out, static_cast<int32_t>(s.min_));
+      detail::put(out, static_cast<int32_t>(s.max_));
+      for (auto& level : s.levels_) {
+          detail::put(out, static_cast<uint32_t>(level.size()));
+          put_array(out, span<const int>(level));
+      }
+  }
+
+  auto detail::sketch_wire::get(span<const byte>& in) -> optional<quantile_sketch> {
+      uint8_t level_count = 0;
+      uint16_t k = 0;
+      uint64_t n = 0;
+      int32_t lo = 0, hi = 0;
+      if (!detail::get(in, level_count) || level_count == 0 || level_count > 64) return nullopt;
+      if (!detail::get(in, k) || !detail::get(in, n) || !detail::get(in, lo) || !detail::get(in, hi)) {
+          return nullopt;
+      }
+
+      quantile_sketch sketch(k);
+      sketch.levels_.resize(level_count);
+      uint64_t weight = 0;
+      for (size_t h = 0; h < level_count; ++h) {
+          uint32_t size = 0;
+          if (!detail::get(in, size) || in.size() / sizeof(int32_t) < size) return nullopt;
+          auto& level = sketch.levels_[h];
+          level.resize(size);
+          get_array(in, span<int>(level));
+          if (h > 0 && !ranges::is_sorted(level)) return nullopt;
+          sketch.retained_ += size;
+          weight += uint64_t{size} << h;
+      }
+      if (weight != n) return nullopt;
+      if (n > 0 && lo > hi) return nullopt;
+
+      sketch.n_ = n;
+      if (n > 0) {
+          sketch.min_ = lo;
+          sketch.max_ = hi;
+      }
+      sketch.update_limit();
+      sketch.compress();
+      return sketch;
+  }
+}
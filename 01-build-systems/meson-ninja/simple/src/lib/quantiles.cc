@@ -0,0 +1,157 @@
+#include "simple-stats.hh"
+#include "probe.hh"
+#include "select.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace ss::detail {
+  using namespace std;
+
+  namespace {
+    // radix pass uses at most 2^16 buckets, sized so that on average
+    // a bucket holds about 16 elements
+    constexpr int max_bucket_bits = 16;
+
+    thread_local select_arena arena;
+  }
+
+  auto thread_arena() -> select_arena& {
+      return arena;
+  }
+
+  radix_buckets::radix_buckets(int lo, int hi, size_t n) : base(key(lo)) {
+      auto width = static_cast<int>(bit_width(key(hi) - base));
+      auto bits = clamp(static_cast<int>(bit_width(n)) - 4, 1, max_bucket_bits);
+      shift = max(0, width - bits);
+      size = (*this)(hi) + 1;
+  }
+
+  auto collect_ranks(size_t n, span<const double> qs, vector<size_t>& ranks) -> void {
+      // every quantile needs at most two order statistics
+      ranks.clear();
+      for (auto q : qs) {
+          if (isnan(q)) continue;
+          auto h = (n - 1) * clamp(q, 0.0, 1.0);
+          auto r = static_cast<size_t>(h);
+          ranks.push_back(r);
+          if (r + 1 < n && h > r) ranks.push_back(r + 1);
+      }
+      ranges::sort(ranks);
+      ranks.erase(unique(ranks.begin(), ranks.end()), ranks.end());
+  }
+
+  auto plan_gather(select_arena& a) -> size_t {
+      a.cursors.clear();
+      a.bases.clear();
+      size_t seen = 0, gathered = 0;
+      for (size_t b = 0, j = 0; b < a.counts.size(); ++b) {
+          auto count = exchange(a.counts[b], 0);
+          auto bucket_first = seen;
+          seen += count;
+          if (j < a.ranks.size() && a.ranks[j] < seen) {
+              a.cursors.push_back(gathered);
+              a.counts[b] = a.cursors.size();
+              for (; j < a.ranks.size() && a.ranks[j] < seen; ++j) {
+                  a.bases.push_back({gathered, bucket_first});
+              }
+              gathered += count;
+          }
+      }
+      return gathered;
+  }
+
+  // ranks are sorted, so the ones sharing a bucket are adjacent
+  auto select_gathered(select_arena& a) -> void {
+      for (size_t i = 0; i < a.ranks.size();) {
+          auto [offset, bucket_first] = a.bases[i];
+          auto end = i;
+          while (end < a.ranks.size() && a.bases[end].offset == offset) ++end;
+
+          auto bucket_end = end < a.ranks.size() ? a.bases[end].offset : a.items.size();
+          auto items = span<int>(a.items).subspan(offset, bucket_end - offset);
+          for (auto r = i; r < end; ++r) a.ranks[r] -= bucket_first;
+          multi_select<int>(items, span<const size_t>(a.ranks).subspan(i, end - i),
+                            span<int>(a.values).subspan(i, end - i));
+          for (auto r = i; r < end; ++r) a.ranks[r] += bucket_first;
+          i = end;
+      }
+  }
+}
+
+namespace ss {
+  using namespace std;
+  using namespace ss::detail;
+
+  namespace {
+    // below this many elements a copy plus nth_element beats setting up
+    // a histogram
+    constexpr size_t select_small = 4096;
+
+    // value ranges up to this wide (and no wider than the data is long)
+    // are answered by counting; 2^20 counters is 8 MiB at most
+    constexpr uint64_t counting_limit = uint64_t{1} << 20;
+
+    auto select_by_counting(span<const int> data, int lo, size_t range, select_arena& a) -> void {
+        a.counts.assign(range + 1, 0);
+        for (auto v : data) ++a.counts[static_cast<size_t>(static_cast<int64_t>(v) - lo)];
+
+        size_t seen = 0, j = 0;
+        for (size_t b = 0; b <= range && j < a.ranks.size(); ++b) {
+            seen += a.counts[b];
+            while (j < a.ranks.size() && a.ranks[j] < seen) {
+                a.values[j++] = static_cast<int>(lo + static_cast<int64_t>(b));
+            }
+        }
+    }
+
+    // one pass to size the buckets, one to copy out just the needed ones
+    auto select_by_radix(span<const int> data, int lo, int hi, select_arena& a) -> void {
+        radix_buckets bucket(lo, hi, data.size());
+        a.counts.assign(bucket.size, 0);
+        for (auto v : data) ++a.counts[bucket(v)];
+
+        a.items.resize(plan_gather(a));
+        for (auto v : data) {
+            if (auto slot = a.counts[bucket(v)]) a.items[a.cursors[slot - 1]++] = v;
+        }
+        select_gathered(a);
+    }
+  }
+
+  auto quantiles(span<const int> data, span<const double> qs, span<double> out) -> void {
+      SS_PROBE(quantiles, data.size());
+      auto n = data.size();
+      if (n == 0) {
+          fill_n(out.begin(), qs.size(), numeric_limits<double>::quiet_NaN());
+          return;
+      }
+
+      auto& a = thread_arena();
+      collect_ranks(n, qs, a.ranks);
+      a.values.resize(a.ranks.size());
+      if (n <= select_small) {
+          a.items.assign(data.begin(), data.end());
+          multi_select<int>(a.items, a.ranks, a.values);
+      } else if (!a.ranks.empty()) {
+          auto [lo, hi] = ranges::minmax(data);
+          auto range = static_cast<uint64_t>(static_cast<int64_t>(hi) - lo);
+          if (range < counting_limit && range < n) {
+              select_by_counting(data, lo, static_cast<size_t>(range), a);
+          } else {
+              select_by_radix(data, lo, hi, a);
+          }
+      }
+      interpolate<int>(n, qs, a.ranks, a.values, out);
+  }
+
+  auto quantiles(span<const int> data, span<const double> qs) -> vector<double> {
+      SS_PROBE(quantiles, data.size());
+      vector<double> out(qs.size());
+      quantiles(data, qs, out);
+      return out;
+  }
+}
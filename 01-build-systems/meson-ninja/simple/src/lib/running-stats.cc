@@ -0,0 +1,142 @@
+#include "running-stats.hh"
+#include "kernels.hh"
+#include "wire.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ss {
+  using namespace std;
+
+  namespace {
+    // 2048 ints is 8 KiB: the block is pulled from memory once by the
+    // exact integer sum and min/max scan, and is still in L1 when the
+    // squared deviations are taken around its own mean
+    constexpr size_t block_size = 2048;
+
+    constexpr uint8_t format_version = 1;
+    constexpr char format_magic[4] = {'s', 's', 'r', 's'};
+
+    auto squared_deviations(const int* data, size_t n, double mean) -> double {
+        // independent accumulators so the adds are not one long chain
+        double acc[4] = {};
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            for (size_t j = 0; j < 4; ++j) {
+                auto d = data[i + j] - mean;
+                acc[j] += d * d;
+            }
+        }
+        for (; i < n; ++i) {
+            auto d = data[i] - mean;
+            acc[0] += d * d;
+        }
+        return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    }
+  }
+
+  auto running_stats::push(span<const int> values) -> void {
+      for (size_t begin = 0; begin < values.size(); begin += block_size) {
+          auto block = values.subspan(begin, min(block_size, values.size() - begin));
+
+          running_stats part;
+          part.count_ = block.size();
+          for (auto v : block) {
+              part.min_ = min(part.min_, v);
+              part.max_ = max(part.max_, v);
+          }
+          // a block's total fits in int64_t; only the running one can wrap
+          auto block_sum = detail::sum_i32(block.data(), block.size());
+          part.sum_ = static_cast<uint64_t>(block_sum);
+          part.mean_ = static_cast<double>(block_sum) / part.count_;
+          part.m2_ = squared_deviations(block.data(), block.size(), part.mean_);
+          merge(part);
+      }
+  }
+
+  auto running_stats::merge(const running_stats& other) -> void {
+      if (other.count_ == 0) return;
+      if (count_ == 0) {
+          *this = other;
+          return;
+      }
+
+      auto n = count_ + other.count_;
+      auto delta = other.mean_ - mean_;
+      mean_ += delta * static_cast<double>(other.count_) / n;
+      m2_ += other.m2_ + delta * delta * (static_cast<double>(count_) * other.count_ / n);
+      count_ = n;
+      sum_ += other.sum_;
+      min_ = std::min(min_, other.min_);
+      max_ = std::max(max_, other.max_);
+  }
+
+  auto running_stats::snapshot() const -> summary {
+      summary s;
+      s.count = count_;
+      if (count_ == 0) {
+          s.mean = s.variance = s.stddev = numeric_limits<double>::quiet_NaN();
+          return s;
+      }
+
+      s.sum = sum();
+      s.mean = static_cast<double>(s.sum) / count_;
+      s.min = min_;
+      s.max = max_;
+      s.variance = m2_ / count_;
+      s.stddev = sqrt(s.variance);
+      return s;
+  }
+
+  // layout: magic[4] version:u8, then the body written by stats_wire
+  auto running_stats::serialize() const -> vector<byte> {
+      vector<byte> out;
+      out.reserve(sizeof(format_magic) + 1 + 40);
+      for (auto c : format_magic) out.push_back(static_cast<byte>(c));
+      detail::put(out, format_version);
+      detail::stats_wire::put(out, *this);
+      return out;
+  }
+
+  auto running_stats::deserialize(span<const byte> in) -> optional<running_stats> {
+      if (in.size() < sizeof(format_magic)) return nullopt;
+      for (size_t i = 0; i < sizeof(format_magic); ++i) {
+          if (in[i] != static_cast<byte>(format_magic[i])) return nullopt;
+      }
+      in = in.subspan(sizeof(format_magic));
+
+      uint8_t version = 0;
+      if (!detail::get(in, version) || version != format_version) return nullopt;
+      auto stats = detail::stats_wire::get(in);
+      if (!stats || !in.empty()) return nullopt;
+      return stats;
+  }
+
+  // body: count:u64 sum:i64 mean:f64 m2:f64 min:i32 max:i32, 40 bytes
+  auto detail::stats_wire::put(vector<byte>& out, const running_stats& s) -> void {
+      detail::put(out, static_cast<uint64_t>(s.count_));
+      detail::put(out, static_cast<int64_t>(s.sum_));
+      detail::put(out, s.mean_);
+      detail::put(out, s.m2_);
+      detail::put(out, static_cast<int32_t>(s.min_));
+      detail::put(out, static_cast<int32_t>(s.max_));
+  }
+
+  auto detail::stats_wire::get(span<const byte>& in) -> optional<running_stats> {
+      uint64_t count = 0;
+      int64_t sum = 0;
+      int32_t lo = 0, hi = 0;
+      running_stats s;
+      if (!detail::get(in, count) || !detail::get(in, sum) || !detail::get(in, s.mean_) ||
+          !detail::get(in, s.m2_) || !detail::get(in, lo) || !detail::get(in, hi)) {
+          return nullopt;
+      }
+      // an empty accumulator keeps its sentinel extremes
+      if (count > 0 && (lo > hi || isnan(s.m2_))) return nullopt;
+      s.count_ = static_cast<size_t>(count);
+      s.sum_ = static_cast<uint64_t>(sum);
+      s.min_ = lo;
+      s.max_ = hi;
+      return s;
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef SIMPLE_STATS_SERIES_STATS_H
+#define SIMPLE_STATS_SERIES_STATS_H
+
+#include "simple-stats.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace ss {
+  /// per-series results of summarize_series; out.x[i] belongs to series
+  /// i. spans left empty are not written, the others must hold at least
+  /// one entry per series. empty series get a sum of 0 and NaN for mean
+  /// and median
+  struct series_outputs {
+    std::span<std::int64_t> sum = {};
+    std::span<double> mean = {};
+    std::span<double> median = {};
+  };
+
+  /// statistics of many series stored back to back in one buffer, in the
+  /// compressed sparse row layout: series i is
+  ///
+  ///   values[offsets[i], offsets[i + 1])
+  ///
+  /// so there is one more offset than there are series, and offsets are
+  /// non-decreasing and end within values
+  ///
+  /// one call replaces a call (and a voi) per series. series are cut into
+  /// batches of about equal cost that run on the ss::parallel pool when
+  /// the buffer is at least parallel::serial_threshold() long; within a
+  /// batch, long series go through the vectorized sum kernel and the
+  /// quantile engine, short ones through loops with no per-call setup.
+  /// medians select over a per-thread copy, so values is never reordered
+  STATS_API auto summarize_series(std::span<const int> values, std::span<const std::size_t> offsets,
+                                  const series_outputs& out) -> void;
+}
+
+#endif /* SIMPLE_STATS_SERIES_STATS_H */
@@ -1,4 +1,7 @@
 #include "simple-stats.hh"
+#include "kernels.hh"
+#include "probe.hh"
+#include "running-stats.hh"
 
 #include <algorithm>
 #include <ranges>
@@ -7,11 +10,13 @@
 namespace ss {
   using namespace std;
 
-  auto sum(const voi& nums) -> int {
-      return accumulate(nums.begin(), nums.end(), 0);
+  auto sum(const voi& nums) -> int64_t {
+      SS_PROBE(sum, nums.size());
+      return detail::sum_i32(nums.data(), nums.size());
   }
 
   auto average(const voi& nums) -> double {
+      SS_PROBE(average, nums.size());
       return static_cast<double>(sum(nums)) / nums.size();
   }
 
@@ -21,16 +26,31 @@ namespace ss {
   //     return n % 2 == 0 ? (nums[n/2 - 1] + nums[n/2]) / 2.0 : nums[n/2];
   // }
 
+  // auto median(voi& nums) -> double {
+  //     auto n = nums.size();
+  //     auto mid = nums.begin() + n / 2;
+  //     std::nth_element(nums.begin(), mid, nums.end());
+  //
+  //     if (n % 2 == 0) {
+  //         auto mid1 = std::max_element(nums.begin(), mid);
+  //         return (*mid1 + *mid) / 2.0;
+  //     } else {
+  //         return *mid;
+  //     }
+  // }
+
   auto median(voi& nums) -> double {
-      auto n = nums.size();
-      auto mid = nums.begin() + n / 2;
-      std::nth_element(nums.begin(), mid, nums.end());
-
-      if (n % 2 == 0) {
-          auto mid1 = std::max_element(nums.begin(), mid);
-          return (*mid1 + *mid) / 2.0;
-      } else {
-          return *mid;
-      }
+      SS_PROBE(median, nums.size());
+      constexpr double half = 0.5;
+      double result;
+      quantiles(nums, span(&half, 1), span(&result, 1));
+      return result;
+  }
+
+  auto summarize(const voi& nums) -> summary {
+      SS_PROBE(summarize, nums.size());
+      running_stats stats;
+      stats.push(nums);
+      return stats.snapshot();
   }
 }
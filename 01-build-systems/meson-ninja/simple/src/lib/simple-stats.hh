@@ -3,6 +3,10 @@
 
 // include *only* the header files that provide the types used by 
 // the publicly exposed functions and interfaces
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
 #include <vector>
 
 #if defined _WIN32 || defined __CYGWIN__
@@ -48,9 +52,128 @@ namespace ss {
   /// vector of integers
   using voi = std::vector<int>;
 
-  STATS_API auto sum(const voi& nums) -> int;
+  /// element types the templated entry points below accept; the library
+  /// carries explicit instantiations for every standard integer type
+  /// from signed char to unsigned long long, and for float and double.
+  /// bool, the character types and long double are left out, so using
+  /// one is a compile error rather than a missing symbol at link time
+  template <typename T>
+  concept sample = std::is_arithmetic_v<T> && !std::is_same_v<T, bool> &&
+                   !std::is_same_v<T, char> && !std::is_same_v<T, wchar_t> &&
+                   !std::is_same_v<T, char8_t> && !std::is_same_v<T, char16_t> &&
+                   !std::is_same_v<T, char32_t> && !std::is_same_v<T, long double>;
+
+  /// accumulator for sums of T: 64 bits for integers (signedness kept;
+  /// a total of 64-bit inputs past its range wraps modulo 2^64), double
+  /// for floating point
+  template <sample T>
+  using sum_type = std::conditional_t<std::is_floating_point_v<T>, double,
+                   std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>>;
+
+  /// what sums of T are added up in: integers of either signedness go
+  /// through std::uint64_t, whose overflow wraps where std::int64_t's is
+  /// undefined, and convert back to sum_type<T> at the end
+  template <sample T>
+  using sum_accumulator = std::conditional_t<std::is_integral_v<T>, std::uint64_t, sum_type<T>>;
+
+  /// read-only view of count values of T spaced stride bytes apart, e.g.
+  /// one field across an array of structs:
+  ///
+  ///   ss::strided_span<double> prices(&rows[0].price, rows.size(), sizeof(row));
+  template <sample T>
+  class strided_span {
+  public:
+    constexpr strided_span(const T* first, std::size_t count, std::ptrdiff_t stride)
+        : first_(reinterpret_cast<const std::byte*>(first)), count_(count), stride_(stride) {}
+
+    constexpr auto size() const -> std::size_t { return count_; }
+    constexpr auto empty() const -> bool { return count_ == 0; }
+    constexpr auto stride() const -> std::ptrdiff_t { return stride_; }
+
+    auto operator[](std::size_t i) const -> T {
+        return *reinterpret_cast<const T*>(first_ + static_cast<std::ptrdiff_t>(i) * stride_);
+    }
+
+    /// packed views can take the contiguous (vectorized) paths
+    auto contiguous() const -> bool { return stride_ == sizeof(T); }
+    auto as_span() const -> std::span<const T> {
+        return {reinterpret_cast<const T*>(first_), count_};
+    }
+
+  private:
+    const std::byte* first_;
+    std::size_t count_;
+    std::ptrdiff_t stride_;
+  };
+
+  /// widening sum; the 64-bit total cannot overflow below 2^32 elements
+  STATS_API auto sum(const voi& nums) -> std::int64_t;
   STATS_API auto average(const voi& nums) -> double;
+  /// nums is left as it was; the reference is kept for compatibility
   STATS_API auto median(voi& nums) -> double;
+
+  /// descriptive statistics gathered in a single pass over the data;
+  /// variance is the population variance (divides by count), and the
+  /// floating point fields are NaN when count is zero
+  template <sample T>
+  struct basic_summary {
+    std::size_t count = 0;
+    sum_type<T> sum = 0;
+    double mean = 0.0;
+    T min = 0;
+    T max = 0;
+    double variance = 0.0;
+    double stddev = 0.0;
+  };
+
+  using summary = basic_summary<int>;
+
+  /// one read of nums instead of one per statistic; the data is walked
+  /// in L1-sized blocks whose moments are merged pairwise (Chan et al.),
+  /// which keeps the variance stable without a second pass over memory;
+  /// see running-stats.hh for the incremental form
+  STATS_API auto summarize(const voi& nums) -> summary;
+
+  /// writes the qs[i] quantile of data to out[i], interpolating linearly
+  /// between order statistics (so q = 0.5 agrees with median); out must
+  /// be at least as long as qs, and gets NaN for empty data or NaN q
+  ///
+  /// every quantile comes from the same pass: narrow value ranges are
+  /// answered from a counting histogram, wide ones by a radix pass that
+  /// sets aside only the buckets holding a requested rank. data is never
+  /// reordered, and only small inputs are copied whole; scratch space is
+  /// per thread and is reused from call to call
+  STATS_API auto quantiles(std::span<const int> data, std::span<const double> qs,
+                           std::span<double> out) -> void;
+
+  /// as above, returning a new vector
+  STATS_API auto quantiles(std::span<const int> data, std::span<const double> qs)
+      -> std::vector<double>;
+
+  // the same functions for any sample type, read in place from a span or
+  // a strided view, so buffers of other types and struct columns need no
+  // conversion to voi. int spans share the kernels of the voi overloads;
+  // strided views fall back to them when packed. quantiles of other
+  // types select over a per-thread copy, and assume there are no NaNs
+
+  template <sample T> STATS_API auto sum(std::span<const T> data) -> sum_type<T>;
+  template <sample T> STATS_API auto sum(strided_span<T> data) -> sum_type<T>;
+
+  template <sample T> STATS_API auto average(std::span<const T> data) -> double;
+  template <sample T> STATS_API auto average(strided_span<T> data) -> double;
+
+  template <sample T> STATS_API auto summarize(std::span<const T> data) -> basic_summary<T>;
+  template <sample T> STATS_API auto summarize(strided_span<T> data) -> basic_summary<T>;
+
+  template <sample T> STATS_API auto median(std::span<const T> data) -> double;
+  template <sample T> STATS_API auto median(strided_span<T> data) -> double;
+
+  template <sample T>
+  STATS_API auto quantiles(std::span<const T> data, std::span<const double> qs,
+                           std::span<double> out) -> void;
+  template <sample T>
+  STATS_API auto quantiles(strided_span<T> data, std::span<const double> qs,
+                           std::span<double> out) -> void;
 }
 
 #endif /* SIMPLE_STATS_H */
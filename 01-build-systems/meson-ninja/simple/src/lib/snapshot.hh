@@ -0,0 +1,92 @@
+#ifndef SIMPLE_STATS_SNAPSHOT_H
+#define SIMPLE_STATS_SNAPSHOT_H
+
+#include "group-aggregate.hh"
+#include "quantile-sketch.hh"
+#include "running-stats.hh"
+#include "simple-stats.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ss {
+  /// what a snapshot entry holds
+  enum class state_kind : std::uint8_t {
+    running_stats = 1,
+    quantile_sketch = 2,
+    int_groups = 3,
+    string_groups = 4,
+  };
+
+  /// named accumulator and sketch states, saved to a file so that a
+  /// restarted process, or another one, picks up where they were instead
+  /// of replaying the input that built them
+  ///
+  /// each entry is kept in its serialized form (see serialize() on the
+  /// state types): put() encodes, get() decodes, and loading a file is a
+  /// check of its framing plus one copy of each entry out of the mapping.
+  /// the format is versioned and little-endian on every host
+  ///
+  /// snapshots of shards combine with merge(), entry by entry, as if the
+  /// states had been built from all of the shards' input
+  class STATS_API snapshot {
+  public:
+    /// store a state under name, replacing any entry of that name
+    auto put(std::string_view name, const running_stats& state) -> void;
+    auto put(std::string_view name, const quantile_sketch& state) -> void;
+    auto put(std::string_view name, const int_group_aggregate& state) -> void;
+    auto put(std::string_view name, const string_group_aggregate& state) -> void;
+
+    /// the state under name; nullopt when there is none, it is of another
+    /// kind, or its bytes do not decode. State is one of the four types
+    /// put() takes
+    template <typename State>
+    auto get(std::string_view name) const -> std::optional<State>;
+
+    auto kind(std::string_view name) const -> std::optional<state_kind>;
+    auto contains(std::string_view name) const -> bool { return entries_.contains(name); }
+    auto size() const -> std::size_t { return entries_.size(); }
+    auto names() const -> std::vector<std::string_view>;
+    auto erase(std::string_view name) -> bool;
+
+    /// fold every entry of other into this snapshot: states under a name
+    /// both hold are merged, the others copied. fails, leaving this
+    /// snapshot as it was, when a shared name holds different kinds or
+    /// either of its entries does not decode
+    auto merge(const snapshot& other) -> std::expected<void, std::string>;
+
+    /// the whole snapshot as one buffer, in the layout of save()
+    auto serialize() const -> std::vector<std::byte>;
+
+    /// inverse of serialize(); checks the framing, not the entries, which
+    /// are checked as they are decoded
+    static auto deserialize(std::span<const std::byte> bytes) -> std::optional<snapshot>;
+
+    /// write to path through a temporary file renamed over it once
+    /// synced, then sync the directory, so a crash leaves either the old
+    /// snapshot or the new one, and success means the new one is durable
+    auto save(const std::string& path) const -> std::expected<void, std::string>;
+
+    /// read a file written by save() through a memory mapping
+    static auto load(const std::string& path) -> std::expected<snapshot, std::string>;
+
+  private:
+    struct entry {
+        state_kind kind;
+        std::vector<std::byte> bytes;
+    };
+
+    auto find(std::string_view name, state_kind kind) const -> const entry*;
+
+    std::map<std::string, entry, std::less<>> entries_;
+  };
+}
+
+#endif /* SIMPLE_STATS_SNAPSHOT_H */
@@ -0,0 +1,113 @@
+#include "thread-pool.hh"
+
+#include <algorithm>
+
+namespace ss::detail {
+  using namespace std;
+
+  namespace {
+    auto pack(size_t front, size_t back) -> uint64_t {
+        return (static_cast<uint64_t>(front) << 32) | static_cast<uint32_t>(back);
+    }
+  }
+
+  auto thread_pool::instance() -> thread_pool& {
+      static thread_pool pool;
+      return pool;
+  }
+
+  thread_pool::thread_pool() {
+      auto hardware = max(1u, thread::hardware_concurrency());
+      queues_ = make_unique<queue[]>(hardware);
+      threads_.reserve(hardware - 1);
+      for (size_t self = 1; self < hardware; ++self) {
+          threads_.emplace_back([this, self] { worker_loop(self); });
+      }
+  }
+
+  thread_pool::~thread_pool() {
+      {
+          lock_guard lock(mutex_);
+          stop_ = true;
+      }
+      wake_.notify_all();
+      for (auto& t : threads_) t.join();
+  }
+
+  auto thread_pool::pop_front(queue& q, size_t& chunk) -> bool {
+      auto range = q.range.load(memory_order_relaxed);
+      while (true) {
+          auto front = range >> 32, back = range & 0xffff'ffff;
+          if (front >= back) return false;
+          if (q.range.compare_exchange_weak(range, pack(front + 1, back), memory_order_acquire)) {
+              chunk = front;
+              return true;
+          }
+      }
+  }
+
+  auto thread_pool::pop_back(queue& q, size_t& chunk) -> bool {
+      auto range = q.range.load(memory_order_relaxed);
+      while (true) {
+          auto front = range >> 32, back = range & 0xffff'ffff;
+          if (front >= back) return false;
+          if (q.range.compare_exchange_weak(range, pack(front, back - 1), memory_order_acquire)) {
+              chunk = back - 1;
+              return true;
+          }
+      }
+  }
+
+  auto thread_pool::work(size_t self) -> void {
+      size_t chunk;
+      while (pop_front(queues_[self], chunk)) (*fn_)(chunk, self);
+
+      // out of our own chunks; help the others, nearest neighbour first
+      for (size_t i = 1; i < active_; ++i) {
+          auto& victim = queues_[(self + i) % active_];
+          while (pop_back(victim, chunk)) (*fn_)(chunk, self);
+      }
+  }
+
+  auto thread_pool::worker_loop(size_t self) -> void {
+      size_t seen = 0;
+      while (true) {
+          {
+              unique_lock lock(mutex_);
+              wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+              if (stop_) return;
+              seen = generation_;
+              if (self >= active_) continue;
+          }
+          work(self);
+          if (pending_.fetch_sub(1, memory_order_acq_rel) == 1) pending_.notify_one();
+      }
+  }
+
+  auto thread_pool::run(size_t chunks, size_t participants, const task& fn) -> void {
+      auto n = min({participants, capacity(), chunks});
+      if (n <= 1 || busy_.exchange(true, memory_order_acquire)) {
+          for (size_t chunk = 0; chunk < chunks; ++chunk) fn(chunk, 0);
+          return;
+      }
+
+      {
+          lock_guard lock(mutex_);
+          fn_ = &fn;
+          active_ = n;
+          for (size_t p = 0; p < n; ++p) {
+              queues_[p].range.store(pack(chunks * p / n, chunks * (p + 1) / n), memory_order_relaxed);
+          }
+          pending_.store(n - 1, memory_order_relaxed);
+          ++generation_;
+      }
+      wake_.notify_all();
+
+      work(0);
+      for (auto left = pending_.load(memory_order_acquire); left != 0;
+           left = pending_.load(memory_order_acquire)) {
+          pending_.wait(left, memory_order_acquire);
+      }
+      busy_.store(false, memory_order_release);
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef SIMPLE_STATS_THREAD_POOL_H
+#define SIMPLE_STATS_THREAD_POOL_H
+
+// internal to the ss library: the one set of worker threads every
+// parallel entry point runs on
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ss::detail {
+  /// fork-join pool with work stealing; started on first use and kept
+  /// for the life of the process
+  ///
+  /// a job is a count of chunks. each participant is handed a contiguous
+  /// run of chunks up front, so neighbouring chunks (and the pages they
+  /// were first touched from) tend to stay with one thread; a participant
+  /// that runs dry steals chunks from the far end of the others' queues
+  class thread_pool {
+  public:
+    /// task(chunk, participant): participant is in [0, participants) and
+    /// identifies the calling thread for the duration of the job, so it
+    /// can index per-thread scratch without locking
+    using task = std::function<void(std::size_t chunk, std::size_t participant)>;
+
+    static auto instance() -> thread_pool&;
+
+    ~thread_pool();
+
+    /// most threads a job can use, counting the caller
+    auto capacity() const -> std::size_t { return threads_.size() + 1; }
+
+    /// runs task over [0, chunks) on up to participants threads and
+    /// returns when every chunk is done; the caller takes part. a job
+    /// submitted while another is running (from another thread, or from
+    /// inside a task) runs inline on the caller, as participant 0
+    auto run(std::size_t chunks, std::size_t participants, const task& fn) -> void;
+
+  private:
+    // a participant's chunks [front, back), packed into one word so the
+    // owner (taking the front) and a thief (taking the back) can never
+    // both claim the last chunk
+    struct alignas(64) queue {
+        std::atomic<std::uint64_t> range{0};
+    };
+
+    thread_pool();
+    auto pop_front(queue& q, std::size_t& chunk) -> bool;
+    auto pop_back(queue& q, std::size_t& chunk) -> bool;
+    auto work(std::size_t self) -> void;
+    auto worker_loop(std::size_t self) -> void;
+
+    std::vector<std::thread> threads_;
+    std::unique_ptr<queue[]> queues_;
+    std::atomic<bool> busy_{false};
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::size_t generation_ = 0;
+    bool stop_ = false;
+
+    // the job in flight; written by run() before waking the workers
+    const task* fn_ = nullptr;
+    std::size_t active_ = 0;
+    std::atomic<std::size_t> pending_{0};
+  };
+}
+
+#endif /* SIMPLE_STATS_THREAD_POOL_H */